@@ -0,0 +1,294 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Benchmark the hot paths of a tick on a World full of ants : spatial index
+// build, a single range query, the neighbourhood pass, the decision pass and
+// a whole World::update.
+//
+// Usage : bench_flocks [--count N]... [--density D]... [--vision V]...
+//                      [--reps R] [--threads T] [--output FILE]
+//                      [--baseline FILE] [--tolerance X]
+//
+// Each option can be repeated to sweep its values. density is the mean
+// number of entities in the square seen by an entity. Results are written
+// as CSV on stdout (and to --output, which can serve as a later baseline).
+// With --baseline, every case found in the baseline is compared, and the
+// exit status is 2 if one got slower than tolerance times its baseline.
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "entity/ant/ant.h"
+#include "world/kdtree.h"
+#include "world/world.h"
+
+#define DEFAULT_REPETITIONS 5
+#define DEFAULT_TOLERANCE 1.2
+#define SINGLE_QUERY_BATCH 1000
+
+struct Config {
+    std::vector<std::size_t> counts{};
+    std::vector<double> densities{};
+    std::vector<float> visions{};
+    int repetitions{DEFAULT_REPETITIONS};
+    unsigned threads{1};
+    std::string output{};
+    std::string baseline{};
+    double tolerance{DEFAULT_TOLERANCE};
+};
+
+struct Result {
+    std::string name{};
+    std::size_t count{0};
+    double density{0};
+    float vision{0};
+    unsigned threads{1};
+    double median_ms{0};
+    double min_ms{0};
+
+    // Identifies the case in a baseline
+    std::string key() const {
+        std::ostringstream out;
+        out << name << "," << count << "," << density << "," << vision << ","
+            << threads;
+        return out.str();
+    }
+};
+
+// Time ops, once per repetition after a warm-up call. prepare runs untimed
+// before each call. ops_per_call divides the durations
+Result measure(const std::string& name, int repetitions,
+               const std::function<void()>& prepare,
+               const std::function<void()>& op, int ops_per_call = 1) {
+    using clock = std::chrono::steady_clock;
+    std::vector<double> samples;
+    prepare();
+    op();
+    for (int rep = 0; rep < repetitions; ++rep) {
+        prepare();
+        auto start = clock::now();
+        op();
+        auto stop = clock::now();
+        samples.push_back(
+            std::chrono::duration<double, std::milli>(stop - start).count() /
+            ops_per_call);
+    }
+    std::sort(samples.begin(), samples.end());
+    Result result;
+    result.name = name;
+    result.median_ms = samples[samples.size() / 2];
+    result.min_ms = samples.front();
+    return result;
+}
+
+std::vector<Result> run_case(std::size_t count, double density, float vision,
+                             const Config& config) {
+    // Side of the square world giving the requested density
+    double side = std::sqrt(count * 4.0 * vision * vision / density);
+    int world_side = std::max(1, static_cast<int>(std::ceil(side)));
+    World world(world_side, world_side, 1.0 / 60);
+    world.set_seed(42);
+    world.set_thread_count(config.threads);
+
+    std::mt19937_64 engine(42);
+    std::uniform_real_distribution<double> coord(0, world_side);
+    std::uniform_real_distribution<double> speed(-5, 5);
+    for (std::size_t i = 0; i < count; ++i) {
+        auto ant = world.add_entity(Entity::Type::ANT, coord(engine),
+                                    coord(engine), speed(engine),
+                                    speed(engine));
+        ant.lock()->set_vision_distance(vision);
+    }
+
+    auto nothing = [] {};
+    std::vector<Result> results;
+    results.push_back(measure("tree_build", config.repetitions, nothing,
+                              [&] { world.update_tree(); }));
+
+    KDTree<Entity> tree;
+    tree.set_periodic_domain(world_side, world_side);
+    tree.build(world.entity_list());
+    const auto& entities = world.entity_list();
+    std::size_t queried = 0;
+    std::size_t found = 0;
+    results.push_back(measure(
+        "single_query", config.repetitions, nothing,
+        [&] {
+            for (int i = 0; i < SINGLE_QUERY_BATCH; ++i) {
+                const auto& entity = entities[queried++ % entities.size()];
+                tree.periodic_range_visit(
+                    entity->pos(), vision,
+                    [&](std::uint32_t, const Eigen::Vector2d&) { ++found; });
+            }
+        },
+        SINGLE_QUERY_BATCH));
+
+    world.update_tree();
+    results.push_back(measure("neighbourhoods", config.repetitions, nothing,
+                              [&] { world.update_entity_neighbourhoods(); }));
+    // Decisions filter the neighbour lists, start each run from fresh ones
+    results.push_back(measure("decision", config.repetitions,
+                              [&] { world.update_entity_neighbourhoods(); },
+                              [&] { world.call_entity_decision(); }));
+    results.push_back(measure("update", config.repetitions, nothing,
+                              [&] { world.update(); }));
+
+    for (auto&& result : results) {
+        result.count = count;
+        result.density = density;
+        result.vision = vision;
+        result.threads = world.thread_count();
+    }
+    return results;
+}
+
+void write_csv(std::ostream& out, const std::vector<Result>& results) {
+    out << "case,count,density,vision,threads,median_ms,min_ms\n";
+    out << std::setprecision(6);
+    for (auto&& result : results) {
+        out << result.key() << "," << result.median_ms << "," << result.min_ms
+            << "\n";
+    }
+}
+
+// Median times of a previous run, keyed by Result::key
+std::map<std::string, double> read_baseline(std::istream& in) {
+    std::map<std::string, double> baseline;
+    std::string line;
+    std::getline(in, line);  // Header
+    while (std::getline(in, line)) {
+        // The key is made of the first 5 fields, the median is the 6th
+        std::size_t cut = 0;
+        for (int field = 0; field < 5 && cut != std::string::npos; ++field) {
+            cut = line.find(',', cut == 0 ? 0 : cut + 1);
+        }
+        if (cut == std::string::npos) {
+            continue;
+        }
+        baseline[line.substr(0, cut)] = std::atof(line.c_str() + cut + 1);
+    }
+    return baseline;
+}
+
+bool parse_args(int argc, char* argv[], Config& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value after " << arg << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--count") {
+            config.counts.push_back(std::stoul(value));
+        } else if (arg == "--density") {
+            config.densities.push_back(std::stod(value));
+        } else if (arg == "--vision") {
+            config.visions.push_back(std::stof(value));
+        } else if (arg == "--reps") {
+            config.repetitions = std::max(1, std::stoi(value));
+        } else if (arg == "--threads") {
+            config.threads = std::stoul(value);
+        } else if (arg == "--output") {
+            config.output = value;
+        } else if (arg == "--baseline") {
+            config.baseline = value;
+        } else if (arg == "--tolerance") {
+            config.tolerance = std::stod(value);
+        } else {
+            std::cerr << "Unknown option " << arg << "\n";
+            return false;
+        }
+    }
+    if (config.counts.empty()) {
+        config.counts = {1000, 10000, 100000};
+    }
+    if (config.densities.empty()) {
+        config.densities = {16};
+    }
+    if (config.visions.empty()) {
+        config.visions = {125};
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Config config;
+    try {
+        if (!parse_args(argc, argv, config)) {
+            return 1;
+        }
+    } catch (const std::logic_error& e) {
+        std::cerr << "Invalid argument : " << e.what() << "\n";
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (auto count : config.counts) {
+        for (auto density : config.densities) {
+            for (auto vision : config.visions) {
+                auto case_results = run_case(count, density, vision, config);
+                results.insert(results.end(), case_results.begin(),
+                               case_results.end());
+            }
+        }
+    }
+
+    write_csv(std::cout, results);
+    if (!config.output.empty()) {
+        std::ofstream output(config.output);
+        if (!output.is_open()) {
+            std::cerr << "Cannot write results to " << config.output << "\n";
+            return 1;
+        }
+        write_csv(output, results);
+    }
+
+    if (config.baseline.empty()) {
+        return 0;
+    }
+    std::ifstream baseline_file(config.baseline);
+    if (!baseline_file.is_open()) {
+        std::cerr << "Cannot read baseline " << config.baseline << "\n";
+        return 1;
+    }
+    auto baseline = read_baseline(baseline_file);
+    bool regression = false;
+    std::cout << "\ncase,count,density,vision,threads,baseline_ms,median_ms,"
+                 "ratio,status\n";
+    for (auto&& result : results) {
+        auto found = baseline.find(result.key());
+        if (found == baseline.end() || found->second <= 0) {
+            continue;
+        }
+        double ratio = result.median_ms / found->second;
+        bool slower = ratio > config.tolerance;
+        regression = regression || slower;
+        std::cout << result.key() << "," << found->second << ","
+                  << result.median_ms << "," << ratio << ","
+                  << (slower ? "REGRESSION" : "ok") << "\n";
+    }
+    return regression ? 2 : 0;
+}
@@ -0,0 +1,116 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compare the neighbour search backends on a periodic world : bulk build of
+// the index, then one periodic range query per point, as
+// World::update_entity_neighbourhoods does every tick.
+//
+// Usage : bench_spatial_index [vision_distance] [repetitions]
+
+#include <Eigen/Dense>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "world/cellgrid.h"
+#include "world/kdtree.h"
+
+// Minimal stand-in for Entity, the indexes only need pos()
+struct Point {
+    Eigen::Vector2d position;
+    inline const Eigen::Vector2d& pos() const { return position; }
+};
+
+struct Timing {
+    double build_ms{0};
+    double query_ms{0};
+    std::size_t neighbours{0};
+};
+
+template <typename Index>
+Timing run(Index& index, const std::vector<std::shared_ptr<Point>>& points,
+           float vision, int repetitions) {
+    using clock = std::chrono::steady_clock;
+    Timing result;
+    for (int rep = 0; rep < repetitions; ++rep) {
+        auto start = clock::now();
+        index.build(points);
+        auto built = clock::now();
+        std::size_t neighbours = 0;
+        for (auto&& point : points) {
+            index.periodic_range_visit(
+                point->pos(), vision,
+                [&](std::uint32_t, const Eigen::Vector2d&) { ++neighbours; });
+        }
+        auto queried = clock::now();
+        result.build_ms +=
+            std::chrono::duration<double, std::milli>(built - start).count();
+        result.query_ms +=
+            std::chrono::duration<double, std::milli>(queried - built).count();
+        result.neighbours = neighbours;
+    }
+    result.build_ms /= repetitions;
+    result.query_ms /= repetitions;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    float vision = argc > 1 ? std::atof(argv[1]) : 125;
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+    // Mean number of points in the query square of a point
+    const std::vector<double> densities = {4, 16, 64};
+    const std::vector<std::size_t> counts = {1000, 10000, 100000};
+
+    std::cout << "backend,count,density,world_side,build_ms,query_ms,"
+                 "mean_neighbours\n";
+    std::mt19937_64 engine(42);
+    for (auto count : counts) {
+        for (auto density : densities) {
+            double query_area = 4.0 * vision * vision;
+            double side = std::sqrt(count * query_area / density);
+            std::uniform_real_distribution<double> coord(0, side);
+            std::vector<std::shared_ptr<Point>> points;
+            points.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                points.push_back(std::make_shared<Point>(
+                    Point{Eigen::Vector2d(coord(engine), coord(engine))}));
+            }
+
+            KDTree<Point> tree;
+            tree.set_periodic_domain(side, side);
+            CellGrid<Point> grid;
+            grid.set_periodic_domain(side, side);
+            grid.set_cell_size(vision);
+
+            auto report = [&](const std::string& name, const Timing& t) {
+                std::cout << name << "," << count << "," << std::fixed
+                          << std::setprecision(1) << density << "," << side
+                          << ","
+                          << std::setprecision(3) << t.build_ms << ","
+                          << t.query_ms << "," << std::setprecision(1)
+                          << static_cast<double>(t.neighbours) / count << "\n";
+            };
+            report("kdtree", run(tree, points, vision, repetitions));
+            report("cellgrid", run(grid, points, vision, repetitions));
+        }
+    }
+
+    return 0;
+}
@@ -14,234 +14,212 @@
 
 #include <algorithm>
 #include "ant.h"
+#include "entity/json_writer.h"
+#include "entity/template_registry.h"
 #include "world/world.h"
 
 Ant::Ant() : Entity() {
     _type = Entity::Type::ANT;
-    _mass = 1;
-    _friction_factor = 0;
+    set_mass(1);
+    set_friction_factor(0);
     set_color(default_color);
-    _vision_distance = 125;
+    _params.vision_distance = 125;
 }
 
 Ant::Ant(int i, World &parent_world) : Entity(i, parent_world) {
     _type = Entity::Type::ANT;
-    _mass = 1;
-    _friction_factor = 0;
+    set_mass(1);
+    set_friction_factor(0);
     set_color(default_color);
-    _vision_distance = 125;
+    _params.vision_distance = 125;
+    place_randomly();
 }
 
 Ant::Ant(int i, World &parent_world, Json::Value &root)
-    : Entity(i, parent_world, std::move(root)) {
-    read_from_json();
-}
+    : Ant(i, parent_world, TemplateRegistry::parse(root)) {}
 
 Ant::Ant(int i, World &world, float x, float y, float vx, float vy, float ax,
          float ay)
     : Entity(i, world, x, y, vx, vy, ax, ay) {
     _type = Entity::Type::ANT;
-    _mass = 1;
-    _friction_factor = 0;
+    set_mass(1);
+    set_friction_factor(0);
     set_color(default_color);
-    _vision_distance = 125;
+    _params.vision_distance = 125;
 }
 
 Ant::Ant(int i, World &world, Json::Value &root, float x, float y, float vx,
          float vy, float ax, float ay)
-    : Entity(i, world, std::move(root), x, y, vx, vy, ax, ay) {
-    read_from_json();
+    : Ant(i, world, TemplateRegistry::parse(root), x, y, vx, vy, ax, ay) {}
+
+Ant::Ant(int i, World &world, const EntityTemplate &entity_template)
+    : Entity(i, world, entity_template) {
+    apply_ant_template(entity_template);
+    place_randomly();
+}
+
+Ant::Ant(int i, World &world, const EntityTemplate &entity_template, float x,
+         float y, float vx, float vy, float ax, float ay)
+    : Entity(i, world, entity_template, x, y, vx, vy, ax, ay) {
+    apply_ant_template(entity_template);
 }
 
 Ant::Ant(float x, float y, float vx, float vy, float ax, float ay)
     : Entity(x, y, vx, vy, ax, ay) {
     _type = Entity::Type::ANT;
-    _mass = 1;
-    _friction_factor = 0;
+    set_mass(1);
+    set_friction_factor(0);
     set_color(default_color);
-    _vision_distance = 125;
+    _params.vision_distance = 125;
 }
 
 void Ant::decision() {
-    filter_neighbours();
-    if (_neighbours.size() <= 1) {
+    NeighbourView neighbour_list = neighbours();
+    std::size_t count = neighbour_list.size();
+    BoidsSums sums;
+    if (count > 0) {
+        // Scratch lanes of the thread, reused from one ant to the next
+        thread_local BoidsLanes lanes;
+        lanes.resize(count);
+        // Slots of the store follow the entity list of the world
+        const auto &positions = _store->positions();
+        const auto &velocities = _store->velocities();
+        for (std::size_t i = 0; i < count; ++i) {
+            std::uint32_t index = neighbour_list.index(i);
+            lanes.x[i] = positions[index](0);
+            lanes.y[i] = positions[index](1);
+            lanes.vx[i] = velocities[index](0);
+            lanes.vy[i] = velocities[index](1);
+        }
+        boids_best_kernel()(boids_query(), lanes, count, sums);
+        neighbour_list.keep(lanes.seen.data());
+    }
+
+    if (sums.count <= 1) {
         set_color(blind_color);
-        _acceleration << 0, 0;
+        mut_acc() << 0, 0;
     } else {
         set_color(default_color);
-        Eigen::Vector2d decided_velocity(0.0, 0.0);
-        decided_velocity = _cohesion_weight * decision_cohesion_velocity();
-        decided_velocity += _alignment_weight * decision_alignment_velocity();
-        decided_velocity += _separation_weight * decision_separation_velocity();
-
-        _acceleration = accel_towards(decided_velocity);
+        double speed = _ant_params.cruise_speed / parent_world->time_step();
+        Eigen::Vector2d cohesion(sums.cohesion[0], sums.cohesion[1]);
+        Eigen::Vector2d alignment(sums.alignment[0], sums.alignment[1]);
+        Eigen::Vector2d separation(sums.separation[0], sums.separation[1]);
+        cohesion.normalize();
+        alignment.normalize();
+        separation.normalize();
+        Eigen::Vector2d decided_velocity =
+            speed * (_ant_params.cohesion_weight * cohesion +
+                     _ant_params.alignment_weight * alignment +
+                     _ant_params.separation_weight * separation);
+
+        mut_acc() = accel_towards(decided_velocity);
         cap_acceleration();
     }
 }
 
-void Ant::filter_neighbours() {
-    if (_velocity.norm() == 0) {
-        filter_neighbours_standing();
+BoidsQuery Ant::boids_query() const {
+    BoidsQuery query;
+    query.x = pos()(0);
+    query.y = pos()(1);
+    double speed = vel().norm();
+    double vision = _params.vision_distance;
+    // A standing ant sees all around, twice as far
+    if (speed == 0) {
+        query.radius_squared = vision * vision * 4;
+        query.cos_threshold = -2;
     } else {
-        filter_neighbours_moving();
+        query.direction_x = vel()(0) / speed;
+        query.direction_y = vel()(1) / speed;
+        query.radius_squared = vision * vision;
+        query.cos_threshold = vision_cos_threshold();
     }
-}
-
-void Ant::filter_neighbours_standing() {
-    _neighbours.erase(
-        std::remove_if(_neighbours.begin(), _neighbours.end(),
-                       [&](std::weak_ptr<Entity> &neigh) -> bool {
-                           if (auto spt = neigh.lock()) {
-                               Eigen::Vector2d vec = spt->pos() - _position;
-                               return vec.squaredNorm() >
-                                      _vision_distance * _vision_distance * 4;
-                           } else {
-                               return true;
-                           }
-                       }),
-        _neighbours.end());
-}
-
-void Ant::filter_neighbours_moving() {
-    _neighbours.erase(std::remove_if(_neighbours.begin(), _neighbours.end(),
-                                    [&](std::weak_ptr<Entity> &neigh) -> bool {
-                                        if (auto spt = neigh.lock()) {
-                                            Eigen::Vector2d vec =
-                                                spt->pos() - _position;
-                                            return !is_in_vision_triangle(vec);
-                                        } else {
-                                            return true;
-                                        }
-                                    }),
-                     _neighbours.end());
+    // Same minimum image as World::point_to
+    query.width = parent_world->_width;
+    query.height = parent_world->_height;
+    query.half_width = parent_world->_width / 2;
+    query.half_height = parent_world->_height / 2;
+    query.separation_offset = vision / 4.0;
+    query.separation_exponent = _ant_params.separation_potential_exp;
+    return query;
+}
+
+bool Ant::vision_cone(VisionCone &cone) const {
+    double speed = vel().norm();
+    if (speed == 0) {
+        return false;
+    }
+    // Same cone as boids_query. Both test it on the minimum image offset, so
+    // the kernel keeps every neighbour found, across the edges too
+    cone.apex = pos();
+    cone.direction = vel() / speed;
+    cone.cos_threshold = vision_cos_threshold();
+    cone.radius = _params.vision_distance;
+    return true;
 }
 
 bool Ant::is_in_vision_triangle(const Eigen::Vector2d &vec) const {
-    if (vec.squaredNorm() > _vision_distance * _vision_distance) {
+    double vision = _params.vision_distance;
+    if (vec.squaredNorm() > vision * vision) {
         return false;
     }
     if (vec.squaredNorm() == 0) {
         return true;
     }
-    float cos_theta = (vec.dot(_velocity)) / (vec.norm() * _velocity.norm());
-
-    return std::acos(cos_theta) < (_vision_angle_degrees * M_PI / 180.0);
+    return vec.dot(vel()) > vision_cos_threshold() * vec.norm() * vel().norm();
 }
 
-Eigen::Vector2d Ant::decision_separation_velocity() const {
-    Eigen::Vector2d desired(0, 0);
-
-    for (auto &&item : _neighbours) {
-        if (auto spt = item.lock()) {
-            if (spt.get() == this) {
-                continue;
-            }
-            Eigen::Vector2d to_rival =
-                parent_world->point_to(_position, spt->pos());
-            Eigen::Vector2d weighted_diff = -1 * to_rival;
-            float dist = weighted_diff.norm();
-            weighted_diff.normalize();
-            weighted_diff /=
-                pow((dist + _vision_distance / 4.0), _separation_potential_exp);
-            desired += weighted_diff;
-        }
+double Ant::vision_cos_threshold() const {
+    // acos(cos_theta) < angle, without the acos
+    double angle = _ant_params.vision_angle_degrees * M_PI / 180.0;
+    if (angle <= 0) {
+        return 2;
+    } else if (angle > M_PI) {
+        return -2;
     }
-    desired.normalize();
-    desired *= _cruise_speed / parent_world->time_step();
-
-    return desired;
+    return std::cos(angle);
 }
 
-Eigen::Vector2d Ant::decision_alignment_velocity() const {
-    Eigen::Vector2d desired(0, 0);
-
-    int considered_neigbours = 0;
-    for (auto &&item : _neighbours) {
-        if (auto spt = item.lock()) {
-            ++considered_neigbours;
-            desired += spt->vel();
-        }
-    }
-
-    if (considered_neigbours > 0) {
-        desired /= considered_neigbours;
-    }
-
-    desired.normalize();
-    desired *= _cruise_speed / parent_world->time_step();
-
-    return desired;
-}
-
-Eigen::Vector2d Ant::decision_cohesion_velocity() const {
-    Eigen::Vector2d desired(0, 0);
-
-    for (auto &&item : _neighbours) {
-        if (auto spt = item.lock()) {
-            desired += parent_world->point_to(_position, spt->pos());
-        }
-    }
-
-    desired.normalize();
-    desired *= _cruise_speed / parent_world->time_step();
-
-    return desired;
+void Ant::apply_ant_template(const EntityTemplate &entity_template) {
+    _type = Entity::Type::ANT;
+    _ant_params = entity_template.ant;
+    std::copy(entity_template.default_color,
+              entity_template.default_color + 4, default_color);
+    std::copy(entity_template.blind_color, entity_template.blind_color + 4,
+              blind_color);
+    std::copy(entity_template.capped_force_color,
+              entity_template.capped_force_color + 4, capped_force_color);
+    set_color(default_color);
 }
 
 void Ant::cap_acceleration() {
-    float norm = _acceleration.norm();
-    if (norm > _max_acceleration) {
+    float norm = acc().norm();
+    if (norm > _params.max_acceleration) {
         set_color(capped_force_color);
-        _acceleration.normalize();
-        _acceleration = _max_acceleration * _acceleration;
+        mut_acc().normalize();
+        mut_acc() *= _params.max_acceleration;
     }
 }
 
 Ant::~Ant() {}
 
-void Ant::update_json() const {
-    Entity::update_json();
-    _json_root["colors"]["default"][0] = default_color[0];
-    _json_root["colors"]["default"][1] = default_color[1];
-    _json_root["colors"]["default"][2] = default_color[2];
-    _json_root["colors"]["default"][3] = default_color[3];
-    _json_root["colors"]["blind"][0] = blind_color[0];
-    _json_root["colors"]["blind"][1] = blind_color[1];
-    _json_root["colors"]["blind"][2] = blind_color[2];
-    _json_root["colors"]["blind"][3] = blind_color[3];
-    _json_root["colors"]["capped_force"][0] = capped_force_color[0];
-    _json_root["colors"]["capped_force"][1] = capped_force_color[1];
-    _json_root["colors"]["capped_force"][2] = capped_force_color[2];
-    _json_root["colors"]["capped_force"][3] = capped_force_color[3];
-    _json_root["decision_weights"]["cohesion"] = _cohesion_weight;
-    _json_root["decision_weights"]["alignment"] = _alignment_weight;
-    _json_root["decision_weights"]["separation"] = _separation_weight;
-    _json_root["separation_potential_exponent"] = _separation_potential_exp;
-    _json_root["cruise_speed"] = _cruise_speed;
-    _json_root["vision"]["angle_degrees"] = _vision_angle_degrees;
-    return;
-}
-
-void Ant::read_from_json() {
-    Entity::read_from_json();
-    default_color[0] = _json_root["colors"]["default"][0].asInt();
-    default_color[1] = _json_root["colors"]["default"][1].asInt();
-    default_color[2] = _json_root["colors"]["default"][2].asInt();
-    default_color[3] = _json_root["colors"]["default"][3].asInt();
-    blind_color[0] = _json_root["colors"]["blind"][0].asInt();
-    blind_color[1] = _json_root["colors"]["blind"][1].asInt();
-    blind_color[2] = _json_root["colors"]["blind"][2].asInt();
-    blind_color[3] = _json_root["colors"]["blind"][3].asInt();
-    capped_force_color[0] = _json_root["colors"]["capped_force"][0].asInt();
-    capped_force_color[1] = _json_root["colors"]["capped_force"][1].asInt();
-    capped_force_color[2] = _json_root["colors"]["capped_force"][2].asInt();
-    capped_force_color[3] = _json_root["colors"]["capped_force"][3].asInt();
-    _cohesion_weight = _json_root["decision_weights"]["cohesion"].asFloat();
-    _alignment_weight = _json_root["decision_weights"]["alignment"].asFloat();
-    _separation_weight = _json_root["decision_weights"]["separation"].asFloat();
-    _separation_potential_exp =
-        _json_root["separation_potential_exponent"].asFloat();
-    _cruise_speed = _json_root["cruise_speed"].asFloat();
-    _vision_angle_degrees = _json_root["vision"]["angle_degrees"].asFloat();
-    return;
+void Ant::write_json_fields(JsonWriter &writer) const {
+    Entity::write_json_fields(writer);
+    writer.key("decision_weights").begin_object();
+    writer.key("cohesion").value(_ant_params.cohesion_weight);
+    writer.key("alignment").value(_ant_params.alignment_weight);
+    writer.key("separation").value(_ant_params.separation_weight);
+    writer.end_object();
+    writer.key("separation_potential_exponent")
+        .value(_ant_params.separation_potential_exp);
+    writer.key("cruise_speed").value(_ant_params.cruise_speed);
+    writer.key("colors").begin_object();
+    writer.key("default").array(default_color, 4);
+    writer.key("blind").array(blind_color, 4);
+    writer.key("capped_force").array(capped_force_color, 4);
+    writer.end_object();
+}
+
+void Ant::write_vision_json_fields(JsonWriter &writer) const {
+    Entity::write_vision_json_fields(writer);
+    writer.key("angle_degrees").value(_ant_params.vision_angle_degrees);
 }
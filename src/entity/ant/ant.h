@@ -15,10 +15,23 @@
 #ifndef ENTITY_ANT_ANT_H_
 #define ENTITY_ANT_ANT_H_
 #include "../entity.h"
+#include "boids_kernel.h"
 #include "jsoncpp/json/json.h"
 
 class Ant : public Entity {
  public:
+    // Parameters specific to ants, kept as one plain block
+    struct AntParams {
+        // Half-angle of the vision cone
+        float vision_angle_degrees{60};
+        float cruise_speed{5};
+        float separation_potential_exp{0.5};
+
+        float cohesion_weight{0.1};
+        float alignment_weight{0.6};
+        float separation_weight{0.3};
+    };
+
     // Default constructor
     Ant();
     // Default constructor that sets the world to live in
@@ -31,68 +44,75 @@ class Ant : public Entity {
     // Constructor that allows placement of the entity
     Ant(int i, World &world, Json::Value &root, float x, float y, float vx = 0,
         float vy = 0, float ax = 0, float ay = 0);
+    // Constructor from a parsed template
+    Ant(int i, World &world, const EntityTemplate &entity_template);
+    // Constructor from a parsed template that allows placement of the entity
+    Ant(int i, World &world, const EntityTemplate &entity_template, float x,
+        float y, float vx = 0, float vy = 0, float ax = 0, float ay = 0);
     // Constructor that allows World-less Ant
     Ant(float x, float y, float vx = 0, float vy = 0, float ax = 0,
         float ay = 0);
 
     ~Ant();
 
-    inline void set_vision_angle_deg(float d) { _vision_angle_degrees = d; }
-    inline void set_cruise_speed(float cs) { _cruise_speed = cs; }
+    inline void set_vision_angle_deg(float d) {
+        _ant_params.vision_angle_degrees = d;
+    }
+    inline void set_cruise_speed(float cs) { _ant_params.cruise_speed = cs; }
     inline void set_separation_exp(float exp) {
-        _separation_potential_exp = exp;
+        _ant_params.separation_potential_exp = exp;
+    }
+    inline void set_cohesion_weight(float wt) {
+        _ant_params.cohesion_weight = wt;
+    }
+    inline void set_alignment_weight(float wt) {
+        _ant_params.alignment_weight = wt;
+    }
+    inline void set_separation_weight(float wt) {
+        _ant_params.separation_weight = wt;
     }
-    inline void set_cohesion_weight(float wt) { _cohesion_weight = wt; }
-    inline void set_alignment_weight(float wt) { _alignment_weight = wt; }
-    inline void set_separation_weight(float wt) { _separation_weight = wt; }
     inline void set_max_force(float max_force) {
-        _max_acceleration = max_force / _mass;
+        _params.max_acceleration = max_force / _params.mass;
     }
 
-    inline float cruise_speed() const { return _cruise_speed; }
-    inline float max_force() const { return _mass * _max_acceleration; }
+    inline float cruise_speed() const { return _ant_params.cruise_speed; }
+    inline float max_force() const {
+        return _params.mass * _params.max_acceleration;
+    }
+    inline const AntParams &ant_params() const { return _ant_params; }
 
-    // Sets acceleration according to the decision of the ant
+    // Sets acceleration according to the decision of the ant. The
+    // neighbours are filtered and the three steering velocities computed in
+    // one pass of the fused boids kernel
     void decision();
-    Eigen::Vector2d decision_cohesion_velocity() const;
-    Eigen::Vector2d decision_alignment_velocity() const;
-    Eigen::Vector2d decision_separation_velocity() const;
-    // Filter the neighbour list so only visible ones remain
-    void filter_neighbours();
     // Return true if vec is in the triangle that is vision_angle_degrees on
-    // each side of velocity, with length <= vision_distance;
+    // each side of velocity, with length <= vision_distance. vec is the
+    // offset on the periodic world, as given by World::point_to
     bool is_in_vision_triangle(const Eigen::Vector2d &vec) const;
-
-    // Update the json object for writing
-    void update_json() const;
-    // Write json to given ostream
-    inline void write_json(std::ostream &out) const {
-        update_json();
-        Json::StreamWriterBuilder wbuilder;
-        wbuilder["indentation"] = "   ";
-        out << Json::writeString(wbuilder, _json_root);
-    }
-    // Read from the json to update the object
-    void read_from_json();
+    // Cosine with the velocity above which a vector lies within
+    // vision_angle_degrees
+    double vision_cos_threshold() const;
+    // Position, vision and separation of the ant for the boids kernels
+    BoidsQuery boids_query() const;
+    // Vision cone of a moving ant. A standing ant sees all around and
+    // returns false
+    bool vision_cone(VisionCone &cone) const;
 
     int default_color[4]{0x22, 0xA0, 0x22, 0xFF};
     int blind_color[4]{0xA0, 0x22, 0x22, 0xFF};
     int capped_force_color[4]{0xA0, 0x22, 0xA0, 0xFF};
 
  protected:
-    float _vision_angle_degrees{60};
-    float _cruise_speed{5};
-    float _separation_potential_exp{0.5};
+    AntParams _ant_params{};
 
-    float _cohesion_weight{0.1};
-    float _alignment_weight{0.6};
-    float _separation_weight{0.3};
+    // Copy the ant parameters and colors of a template
+    void apply_ant_template(const EntityTemplate &entity_template);
+
+    void write_json_fields(JsonWriter &writer) const;
+    void write_vision_json_fields(JsonWriter &writer) const;
 
     void cap_acceleration();
     void cap_force(float max_force);
-
-    void filter_neighbours_standing();
-    void filter_neighbours_moving();
 };
 
 #endif  // ENTITY_ANT_ANT_H_
@@ -0,0 +1,360 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "boids_kernel.h"
+#include <cmath>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BOIDS_X86 1
+#include <immintrin.h>
+#else
+#define BOIDS_X86 0
+#endif
+
+namespace {
+inline double minimum_image(double offset, double period, double half) {
+    if (offset > half) {
+        return offset - period;
+    } else if (offset < -half) {
+        return offset + period;
+    }
+    return offset;
+}
+
+// Process neighbour i alone. Also finishes the vector kernels
+inline void boids_lane(const BoidsQuery &query, BoidsLanes &lanes,
+                       std::size_t i, BoidsSums &sums) {
+    double ox = minimum_image(lanes.x[i] - query.x, query.width,
+                              query.half_width);
+    double oy = minimum_image(lanes.y[i] - query.y, query.height,
+                              query.half_height);
+    double distance_squared = ox * ox + oy * oy;
+    double distance = std::sqrt(distance_squared);
+    bool seen = distance_squared <= query.radius_squared &&
+                (distance_squared == 0 ||
+                 ox * query.direction_x + oy * query.direction_y >
+                     query.cos_threshold * distance);
+    lanes.seen[i] = seen;
+    if (!seen) {
+        return;
+    }
+    ++sums.count;
+    sums.cohesion[0] += ox;
+    sums.cohesion[1] += oy;
+    sums.alignment[0] += lanes.vx[i];
+    sums.alignment[1] += lanes.vy[i];
+    if (distance > 0) {
+        double factor =
+            1 / (distance * std::pow(distance + query.separation_offset,
+                                     query.separation_exponent));
+        sums.separation[0] -= factor * ox;
+        sums.separation[1] -= factor * oy;
+    }
+}
+
+void boids_kernel_scalar(const BoidsQuery &query, BoidsLanes &lanes,
+                         std::size_t count, BoidsSums &sums) {
+    for (std::size_t i = 0; i < count; ++i) {
+        boids_lane(query, lanes, i, sums);
+    }
+}
+
+#if BOIDS_X86
+// The vector kernels take the usual exponents with square roots, and call
+// std::pow lane by lane for the others
+__attribute__((target("sse2"))) inline __m128d separation_potential_sse2(
+    __m128d base, double exponent) {
+    if (exponent == 0.5) {
+        return _mm_sqrt_pd(base);
+    } else if (exponent == 0.25) {
+        return _mm_sqrt_pd(_mm_sqrt_pd(base));
+    } else if (exponent == 1) {
+        return base;
+    }
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, base);
+    for (double &lane : lanes) {
+        lane = std::pow(lane, exponent);
+    }
+    return _mm_load_pd(lanes);
+}
+
+__attribute__((target("sse2"))) inline double horizontal_sum_sse2(
+    __m128d lanes) {
+    alignas(16) double sum[2];
+    _mm_store_pd(sum, lanes);
+    return sum[0] + sum[1];
+}
+
+__attribute__((target("sse2"))) void boids_kernel_sse2(
+    const BoidsQuery &query, BoidsLanes &lanes, std::size_t count,
+    BoidsSums &sums) {
+    const __m128d x = _mm_set1_pd(query.x);
+    const __m128d y = _mm_set1_pd(query.y);
+    const __m128d direction_x = _mm_set1_pd(query.direction_x);
+    const __m128d direction_y = _mm_set1_pd(query.direction_y);
+    const __m128d radius_squared = _mm_set1_pd(query.radius_squared);
+    const __m128d cos_threshold = _mm_set1_pd(query.cos_threshold);
+    const __m128d width = _mm_set1_pd(query.width);
+    const __m128d height = _mm_set1_pd(query.height);
+    const __m128d half_width = _mm_set1_pd(query.half_width);
+    const __m128d half_height = _mm_set1_pd(query.half_height);
+    const __m128d separation_offset = _mm_set1_pd(query.separation_offset);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+    __m128d cohesion_x = zero, cohesion_y = zero;
+    __m128d alignment_x = zero, alignment_y = zero;
+    __m128d separation_x = zero, separation_y = zero;
+
+    std::size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(&lanes.x[i]), x);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(&lanes.y[i]), y);
+        __m128d ox = _mm_add_pd(
+            _mm_sub_pd(dx, _mm_and_pd(_mm_cmpgt_pd(dx, half_width), width)),
+            _mm_and_pd(_mm_cmplt_pd(dx, _mm_sub_pd(zero, half_width)),
+                       width));
+        __m128d oy = _mm_add_pd(
+            _mm_sub_pd(dy, _mm_and_pd(_mm_cmpgt_pd(dy, half_height), height)),
+            _mm_and_pd(_mm_cmplt_pd(dy, _mm_sub_pd(zero, half_height)),
+                       height));
+        __m128d distance_squared =
+            _mm_add_pd(_mm_mul_pd(ox, ox), _mm_mul_pd(oy, oy));
+        __m128d distance = _mm_sqrt_pd(distance_squared);
+        __m128d dot = _mm_add_pd(_mm_mul_pd(ox, direction_x),
+                                 _mm_mul_pd(oy, direction_y));
+        __m128d in_cone =
+            _mm_cmpgt_pd(dot, _mm_mul_pd(cos_threshold, distance));
+        __m128d seen = _mm_and_pd(
+            _mm_cmple_pd(distance_squared, radius_squared),
+            _mm_or_pd(_mm_cmpeq_pd(distance_squared, zero), in_cone));
+        int mask = _mm_movemask_pd(seen);
+        lanes.seen[i] = mask & 1;
+        lanes.seen[i + 1] = (mask >> 1) & 1;
+        if (mask == 0) {
+            continue;
+        }
+        sums.count += (mask & 1) + ((mask >> 1) & 1);
+
+        ox = _mm_and_pd(seen, ox);
+        oy = _mm_and_pd(seen, oy);
+        distance = _mm_and_pd(seen, distance);
+        cohesion_x = _mm_add_pd(cohesion_x, ox);
+        cohesion_y = _mm_add_pd(cohesion_y, oy);
+        alignment_x = _mm_add_pd(
+            alignment_x, _mm_and_pd(seen, _mm_loadu_pd(&lanes.vx[i])));
+        alignment_y = _mm_add_pd(
+            alignment_y, _mm_and_pd(seen, _mm_loadu_pd(&lanes.vy[i])));
+
+        __m128d potential = separation_potential_sse2(
+            _mm_add_pd(distance, separation_offset),
+            query.separation_exponent);
+        // Neighbours on top of the ant (itself) push nowhere
+        __m128d factor =
+            _mm_and_pd(_mm_cmpgt_pd(distance, zero),
+                       _mm_div_pd(one, _mm_mul_pd(distance, potential)));
+        separation_x = _mm_sub_pd(separation_x, _mm_mul_pd(factor, ox));
+        separation_y = _mm_sub_pd(separation_y, _mm_mul_pd(factor, oy));
+    }
+
+    sums.cohesion[0] += horizontal_sum_sse2(cohesion_x);
+    sums.cohesion[1] += horizontal_sum_sse2(cohesion_y);
+    sums.alignment[0] += horizontal_sum_sse2(alignment_x);
+    sums.alignment[1] += horizontal_sum_sse2(alignment_y);
+    sums.separation[0] += horizontal_sum_sse2(separation_x);
+    sums.separation[1] += horizontal_sum_sse2(separation_y);
+    for (; i < count; ++i) {
+        boids_lane(query, lanes, i, sums);
+    }
+}
+
+__attribute__((target("avx2"))) inline __m256d separation_potential_avx2(
+    __m256d base, double exponent) {
+    if (exponent == 0.5) {
+        return _mm256_sqrt_pd(base);
+    } else if (exponent == 0.25) {
+        return _mm256_sqrt_pd(_mm256_sqrt_pd(base));
+    } else if (exponent == 1) {
+        return base;
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, base);
+    for (double &lane : lanes) {
+        lane = std::pow(lane, exponent);
+    }
+    return _mm256_load_pd(lanes);
+}
+
+__attribute__((target("avx2"))) inline double horizontal_sum_avx2(
+    __m256d lanes) {
+    alignas(32) double sum[4];
+    _mm256_store_pd(sum, lanes);
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+__attribute__((target("avx2"))) void boids_kernel_avx2(
+    const BoidsQuery &query, BoidsLanes &lanes, std::size_t count,
+    BoidsSums &sums) {
+    const __m256d x = _mm256_set1_pd(query.x);
+    const __m256d y = _mm256_set1_pd(query.y);
+    const __m256d direction_x = _mm256_set1_pd(query.direction_x);
+    const __m256d direction_y = _mm256_set1_pd(query.direction_y);
+    const __m256d radius_squared = _mm256_set1_pd(query.radius_squared);
+    const __m256d cos_threshold = _mm256_set1_pd(query.cos_threshold);
+    const __m256d width = _mm256_set1_pd(query.width);
+    const __m256d height = _mm256_set1_pd(query.height);
+    const __m256d half_width = _mm256_set1_pd(query.half_width);
+    const __m256d half_height = _mm256_set1_pd(query.half_height);
+    const __m256d minus_half_width = _mm256_set1_pd(-query.half_width);
+    const __m256d minus_half_height = _mm256_set1_pd(-query.half_height);
+    const __m256d separation_offset =
+        _mm256_set1_pd(query.separation_offset);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    __m256d cohesion_x = zero, cohesion_y = zero;
+    __m256d alignment_x = zero, alignment_y = zero;
+    __m256d separation_x = zero, separation_y = zero;
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(&lanes.x[i]), x);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(&lanes.y[i]), y);
+        __m256d ox = _mm256_add_pd(
+            _mm256_sub_pd(
+                dx, _mm256_and_pd(_mm256_cmp_pd(dx, half_width, _CMP_GT_OQ),
+                                  width)),
+            _mm256_and_pd(_mm256_cmp_pd(dx, minus_half_width, _CMP_LT_OQ),
+                          width));
+        __m256d oy = _mm256_add_pd(
+            _mm256_sub_pd(
+                dy, _mm256_and_pd(_mm256_cmp_pd(dy, half_height, _CMP_GT_OQ),
+                                  height)),
+            _mm256_and_pd(_mm256_cmp_pd(dy, minus_half_height, _CMP_LT_OQ),
+                          height));
+        __m256d distance_squared =
+            _mm256_add_pd(_mm256_mul_pd(ox, ox), _mm256_mul_pd(oy, oy));
+        __m256d distance = _mm256_sqrt_pd(distance_squared);
+        __m256d dot = _mm256_add_pd(_mm256_mul_pd(ox, direction_x),
+                                    _mm256_mul_pd(oy, direction_y));
+        __m256d in_cone = _mm256_cmp_pd(
+            dot, _mm256_mul_pd(cos_threshold, distance), _CMP_GT_OQ);
+        __m256d seen = _mm256_and_pd(
+            _mm256_cmp_pd(distance_squared, radius_squared, _CMP_LE_OQ),
+            _mm256_or_pd(_mm256_cmp_pd(distance_squared, zero, _CMP_EQ_OQ),
+                         in_cone));
+        int mask = _mm256_movemask_pd(seen);
+        for (int lane = 0; lane < 4; ++lane) {
+            lanes.seen[i + lane] = (mask >> lane) & 1;
+        }
+        if (mask == 0) {
+            continue;
+        }
+        sums.count += __builtin_popcount(mask);
+
+        ox = _mm256_and_pd(seen, ox);
+        oy = _mm256_and_pd(seen, oy);
+        distance = _mm256_and_pd(seen, distance);
+        cohesion_x = _mm256_add_pd(cohesion_x, ox);
+        cohesion_y = _mm256_add_pd(cohesion_y, oy);
+        alignment_x = _mm256_add_pd(
+            alignment_x, _mm256_and_pd(seen, _mm256_loadu_pd(&lanes.vx[i])));
+        alignment_y = _mm256_add_pd(
+            alignment_y, _mm256_and_pd(seen, _mm256_loadu_pd(&lanes.vy[i])));
+
+        __m256d potential = separation_potential_avx2(
+            _mm256_add_pd(distance, separation_offset),
+            query.separation_exponent);
+        // Neighbours on top of the ant (itself) push nowhere
+        __m256d factor = _mm256_and_pd(
+            _mm256_cmp_pd(distance, zero, _CMP_GT_OQ),
+            _mm256_div_pd(one, _mm256_mul_pd(distance, potential)));
+        separation_x =
+            _mm256_sub_pd(separation_x, _mm256_mul_pd(factor, ox));
+        separation_y =
+            _mm256_sub_pd(separation_y, _mm256_mul_pd(factor, oy));
+    }
+
+    sums.cohesion[0] += horizontal_sum_avx2(cohesion_x);
+    sums.cohesion[1] += horizontal_sum_avx2(cohesion_y);
+    sums.alignment[0] += horizontal_sum_avx2(alignment_x);
+    sums.alignment[1] += horizontal_sum_avx2(alignment_y);
+    sums.separation[0] += horizontal_sum_avx2(separation_x);
+    sums.separation[1] += horizontal_sum_avx2(separation_y);
+    for (; i < count; ++i) {
+        boids_lane(query, lanes, i, sums);
+    }
+}
+#endif  // BOIDS_X86
+}  // namespace
+
+bool boids_isa_supported(BoidsIsa isa) {
+    switch (isa) {
+        case (BoidsIsa::SCALAR):
+            return true;
+#if BOIDS_X86
+        case (BoidsIsa::SSE2):
+            return __builtin_cpu_supports("sse2");
+        case (BoidsIsa::AVX2):
+            return __builtin_cpu_supports("avx2");
+#endif  // BOIDS_X86
+        default:
+            return false;
+    }
+}
+
+BoidsKernel boids_kernel(BoidsIsa isa) {
+    if (!boids_isa_supported(isa)) {
+        return nullptr;
+    }
+    switch (isa) {
+#if BOIDS_X86
+        case (BoidsIsa::SSE2):
+            return boids_kernel_sse2;
+        case (BoidsIsa::AVX2):
+            return boids_kernel_avx2;
+#endif  // BOIDS_X86
+        case (BoidsIsa::SCALAR):
+        default:
+            return boids_kernel_scalar;
+    }
+}
+
+BoidsIsa boids_best_isa() {
+    static const BoidsIsa best = [] {
+        for (BoidsIsa isa : {BoidsIsa::AVX2, BoidsIsa::SSE2}) {
+            if (boids_isa_supported(isa)) {
+                return isa;
+            }
+        }
+        return BoidsIsa::SCALAR;
+    }();
+    return best;
+}
+
+BoidsKernel boids_best_kernel() {
+    static const BoidsKernel best = boids_kernel(boids_best_isa());
+    return best;
+}
+
+const char *boids_isa_name(BoidsIsa isa) {
+    switch (isa) {
+        case (BoidsIsa::SSE2):
+            return "sse2";
+        case (BoidsIsa::AVX2):
+            return "avx2";
+        case (BoidsIsa::SCALAR):
+        default:
+            return "scalar";
+    }
+}
@@ -0,0 +1,95 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENTITY_ANT_BOIDS_KERNEL_H_
+#define ENTITY_ANT_BOIDS_KERNEL_H_
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Neighbours of an ant gathered into contiguous lanes, one array per
+// coordinate, so that the kernels load several neighbours at once
+struct BoidsLanes {
+    std::vector<double> x{};
+    std::vector<double> y{};
+    std::vector<double> vx{};
+    std::vector<double> vy{};
+    // Output of the kernels : 1 if the neighbour is seen
+    std::vector<std::uint8_t> seen{};
+
+    inline void resize(std::size_t count) {
+        x.resize(count);
+        y.resize(count);
+        vx.resize(count);
+        vy.resize(count);
+        seen.resize(count);
+    }
+};
+
+// Everything a kernel needs to know about the ant looking
+struct BoidsQuery {
+    // Position of the ant
+    double x{0};
+    double y{0};
+    // Unit vector along the velocity, null when the ant stands still
+    double direction_x{0};
+    double direction_y{0};
+    // Neighbours further than that (squared) are not seen
+    double radius_squared{0};
+    // Neighbours seen have a cosine with direction above the threshold
+    double cos_threshold{-2};
+    // World size, and the offsets beyond which an offset wraps around
+    double width{0};
+    double height{0};
+    double half_width{0};
+    double half_height{0};
+    // Separation of a neighbour at distance d is 1 / (d + offset)^exponent
+    double separation_offset{0};
+    double separation_exponent{0};
+};
+
+// Steering sums over the neighbours seen
+struct BoidsSums {
+    // Sum of the minimum image offsets towards the neighbours
+    double cohesion[2]{0, 0};
+    // Sum of the velocities of the neighbours
+    double alignment[2]{0, 0};
+    // Sum of the separation vectors away from the neighbours
+    double separation[2]{0, 0};
+    // Number of neighbours seen
+    std::uint32_t count{0};
+};
+
+// Instruction sets a kernel can be built for
+enum class BoidsIsa : int { SCALAR, SSE2, AVX2 };
+
+// Fused boids kernel : in one pass over the count neighbours of lanes, set
+// lanes.seen with the vision mask and add to sums the cohesion, alignment
+// and separation terms of the neighbours seen. Every offset is taken on the
+// periodic world, as World::point_to does, so a neighbour across a seam is
+// seen as it is found by the neighbourhood queries
+typedef void (*BoidsKernel)(const BoidsQuery &query, BoidsLanes &lanes,
+                            std::size_t count, BoidsSums &sums);
+
+// True if the processor runs the kernel built for isa
+bool boids_isa_supported(BoidsIsa isa);
+// Kernel built for isa, nullptr if the processor does not support it
+BoidsKernel boids_kernel(BoidsIsa isa);
+// Widest instruction set supported, checked once
+BoidsIsa boids_best_isa();
+// Kernel of boids_best_isa
+BoidsKernel boids_best_kernel();
+const char *boids_isa_name(BoidsIsa isa);
+
+#endif  // ENTITY_ANT_BOIDS_KERNEL_H_
@@ -15,6 +15,8 @@
 #include "entity.h"
 #include "entity/ant/ant.h"
 #include "entity/food/food.h"
+#include "json_writer.h"
+#include "template_registry.h"
 #include "world/world.h"
 
 std::string Entity::type_string() const {
@@ -27,86 +29,131 @@ std::string Entity::type_string() const {
             break;
         case (Type::NONE):
         default:
-            std::cerr << "The type has not been defined !!\n";
+            LOG_WARNING("The type has not been defined !!");
             return "";
     }
 }
 
-Entity::Entity(int i, World &world) : ent_id(i), parent_world(&world) {
-    std::random_device r;
-    std::default_random_engine e1(r());
-    std::uniform_real_distribution<double> width_dist(0, world._width);
-    std::uniform_real_distribution<double> height_dist(0, world._height);
-
-    _position(0) = width_dist(e1);
-    _position(1) = height_dist(e1);
+Entity::Type Entity::type_from_string(const std::string &type) {
+    if (type == "Ant") {
+        return Type::ANT;
+    } else if (type == "Food") {
+        return Type::FOOD;
+    }
+    return Type::NONE;
 }
 
-Entity::Entity(int i, World &world, Json::Value &&root) : Entity(i, world) {
-    _json_root = std::move(root);
-    read_from_json();
-}
+Entity::Entity(int i, World &world) : ent_id(i), parent_world(&world) {}
+
+Entity::Entity(int i, World &world, Json::Value &&root)
+    : Entity(i, world, TemplateRegistry::parse(root)) {}
 
 Entity::Entity(int i, World &world, float x, float y, float vx, float vy,
                float ax, float ay)
-    : ent_id(i),
-      parent_world(&world),
-      _position(x, y),
-      _velocity(vx, vy),
-      _acceleration(ax, ay) {}
+    : ent_id(i), parent_world(&world) {
+    mut_pos() << x, y;
+    mut_vel() << vx, vy;
+    mut_acc() << ax, ay;
+}
 
 Entity::Entity(int i, World &world, Json::Value &&root, float x, float y,
                float vx, float vy, float ax, float ay)
+    : Entity(i, world, TemplateRegistry::parse(root), x, y, vx, vy, ax, ay) {}
+
+Entity::Entity(int i, World &world, const EntityTemplate &entity_template)
+    : Entity(i, world) {
+    apply_template(entity_template);
+}
+
+Entity::Entity(int i, World &world, const EntityTemplate &entity_template,
+               float x, float y, float vx, float vy, float ax, float ay)
     : Entity(i, world, x, y, vx, vy, ax, ay) {
-    _json_root = std::move(root);
-    read_from_json();
+    apply_template(entity_template);
 }
 
-Entity::Entity(float x, float y, float vx, float vy, float ax, float ay)
-    : _position(x, y), _velocity(vx, vy), _acceleration(ax, ay) {}
+Entity::Entity(float x, float y, float vx, float vy, float ax, float ay) {
+    mut_pos() << x, y;
+    mut_vel() << vx, vy;
+    mut_acc() << ax, ay;
+}
 
 Eigen::Vector2d Entity::compute_friction_acceleration() {
-    Eigen::Vector2d result = -1 * _velocity;
-    result.normalize();
-    float vel_norm = _velocity.norm();
-    float scaling_factor = _friction_factor * vel_norm;
-
-    if (scaling_factor >= _mass * vel_norm / parent_world->_time_step) {
-        scaling_factor = vel_norm * _mass / parent_world->_time_step;
-    }
-
-    result *= scaling_factor / _mass;
-    return result;
+    return friction_acceleration(vel(), _store->drag(_store_slot),
+                                 parent_world->_time_step);
 }
 
-void Entity::decision() { _acceleration << 0, 0; }
+void Entity::decision() { mut_acc() << 0, 0; }
+
+bool Entity::vision_cone(VisionCone &) const { return false; }
 
 void Entity::update() {
-    _acceleration += compute_friction_acceleration();
-    _velocity += parent_world->_time_step * _acceleration;
-    _position += parent_world->_time_step * _velocity;
-    parent_world->wrap_around(_position);
+    mut_acc() += compute_friction_acceleration();
+    mut_vel() += parent_world->_time_step * acc();
+    mut_pos() += parent_world->_time_step * vel();
+    parent_world->wrap_around(mut_pos());
 
-    _acceleration << 0, 0;
+    mut_acc() << 0, 0;
 }
 
 void Entity::print() const {
     std::cout << "***********************************\n";
-    std::cout << "Position : " << _position(0) << "\t" << _position(1) << "\n";
-    std::cout << "Velocity : " << _velocity(0) << "\t" << _velocity(1) << "\n";
-    std::cout << "Acceleration : " << _acceleration(0) << "\t" << _acceleration(1)
-              << "\n";
+    std::cout << "Position : " << pos()(0) << "\t" << pos()(1) << "\n";
+    std::cout << "Velocity : " << vel()(0) << "\t" << vel()(1) << "\n";
+    std::cout << "Acceleration : " << acc()(0) << "\t" << acc()(1) << "\n";
+}
+
+Entity::~Entity() { _store->release(_store_slot); }
+
+void Entity::log_deletion() const {
+    LOG_DEBUG("Deleting " << type_string() << " " << ent_id << " ("
+                          << pos()(0) << ", " << pos()(1) << ")");
 }
 
-Entity::~Entity() {
-    for (auto &&neighbour : _neighbours) {
-        neighbour.reset();
+void Entity::move_to_store(EntityStore &store, bool release) {
+    if (&store == _store) {
+        return;
     }
+    std::uint32_t slot = store.acquire(this);
+    store.position(slot) = pos();
+    store.velocity(slot) = vel();
+    store.acceleration(slot) = acc();
+    store.drag(slot) = _store->drag(_store_slot);
+    if (release) {
+        _store->release(_store_slot);
+    }
+    _store = &store;
+    _store_slot = slot;
+}
+
+void Entity::apply_template(const EntityTemplate &entity_template) {
+    _type = entity_template.type;
+    _params = entity_template.params;
+    update_drag();
+}
+
+void Entity::place_randomly() {
+    RandomStream stream = parent_world->random_stream(_type, ent_id);
+    mut_pos()(0) = stream.uniform(0, parent_world->_width);
+    mut_pos()(1) = stream.uniform(0, parent_world->_height);
+}
+
+void Entity::update_drag() {
+    _store->drag(_store_slot) =
+        _params.mass > 0 ? _params.friction_factor / _params.mass : 0;
+}
+
+NeighbourView Entity::neighbours() const {
+    if (parent_world == nullptr) {
+        return NeighbourView();
+    }
+    return parent_world->neighbour_view(_slot);
 }
 
+void Entity::clear_neighbours() { neighbours().clear(); }
+
 Eigen::Vector2d Entity::accel_towards(const Eigen::Vector2d &target_velocity) {
     float dt = parent_world->time_step();
-    Eigen::Vector2d result = target_velocity - _velocity;
+    Eigen::Vector2d result = target_velocity - vel();
     result /= dt;
     return result;
 }
@@ -128,44 +175,30 @@ bool operator==(const std::weak_ptr<Entity> &lhs,
     return lhs.lock().get() == rhs.lock().get();
 }
 
-void Entity::update_json() const {
-    _json_root["type"] = type_string();
-    _json_root["id"] = ent_id;
-    _json_root["vision"]["distance"] = _vision_distance;
-    _json_root["size"][0] = _size(0);
-    _json_root["size"][1] = _size(1);
-    _json_root["world_situation"]["position"][0] = _position(0);
-    _json_root["world_situation"]["position"][1] = _position(1);
-    _json_root["world_situation"]["velocity"][0] = _velocity(0);
-    _json_root["world_situation"]["velocity"][1] = _velocity(1);
-    _json_root["world_situation"]["acceleration"][0] = _acceleration(0);
-    _json_root["world_situation"]["acceleration"][1] = _acceleration(1);
-    _json_root["mass"] = _mass;
-    _json_root["max_acceleration"] = _max_acceleration;
-    _json_root["friction_factor"] = _friction_factor;
-}
-
-void Entity::read_from_json() {
-    if (_json_root["type"] == "Food") {
-        _type = Type::FOOD;
-    } else if (_json_root["type"] == "Ant") {
-        _type = Type::ANT;
-    } else {
-        _type = Type::NONE;
-    }
-    // ent_id = json_root["id"].asInt();
-    _vision_distance = _json_root["vision"]["distance"].asFloat();
-    _size(0) = _json_root["size"][0].asDouble();
-    _size(1) = _json_root["size"][1].asDouble();
-    // position(0) = json_root["world_situation"]["position"][0].asDouble();
-    // position(1) = json_root["world_situation"]["position"][1].asDouble();
-    // velocity(0) = json_root["world_situation"]["velocity"][0].asDouble();
-    // velocity(1) = json_root["world_situation"]["velocity"][1].asDouble();
-    // acceleration(0) =
-    // json_root["world_situation"]["acceleration"][0].asDouble();
-    // acceleration(1) =
-    // json_root["world_situation"]["acceleration"][1].asDouble();
-    _mass = _json_root["mass"].asFloat();
-    _max_acceleration = _json_root["max_acceleration"].asFloat();
-    _friction_factor = _json_root["friction_factor"].asFloat();
+void Entity::write_json(std::ostream &out) const {
+    JsonWriter writer(out);
+    writer.begin_object();
+    write_json_fields(writer);
+    writer.end_object();
+}
+
+void Entity::write_json_fields(JsonWriter &writer) const {
+    writer.key("type").value(type_string());
+    writer.key("id").value(ent_id);
+    writer.key("vision").begin_object();
+    write_vision_json_fields(writer);
+    writer.end_object();
+    writer.key("size").array(_params.size.data(), 2);
+    writer.key("world_situation").begin_object();
+    writer.key("position").array(pos().data(), 2);
+    writer.key("velocity").array(vel().data(), 2);
+    writer.key("acceleration").array(acc().data(), 2);
+    writer.end_object();
+    writer.key("mass").value(_params.mass);
+    writer.key("max_acceleration").value(_params.max_acceleration);
+    writer.key("friction_factor").value(_params.friction_factor);
+}
+
+void Entity::write_vision_json_fields(JsonWriter &writer) const {
+    writer.key("distance").value(_params.vision_distance);
 }
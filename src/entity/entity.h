@@ -15,25 +15,51 @@
 #ifndef ENTITY_ENTITY_H_
 #define ENTITY_ENTITY_H_
 #include <Eigen/Dense>
+#include <cstdint>
 #include <iostream>
 #include <limits>
 #include <memory>
-#include <random>
 #include <string>
+#include <vector>
+#include "entity_store.h"
 #include "jsoncpp/json/json.h"
+#include "log/log.h"
+#include "world/vision_cone.h"
+
+// Slot of an Entity that does not live in a World entity list
+#define ENTITY_NO_SLOT 0xFFFFFFFFu
 
 class World;
 class Ant;
 class Food;
+class EntityPools;
+class NeighbourView;
+class JsonWriter;
+struct EntityTemplate;
 
 // Entity that lives in World and can move/should be displayed
 class Entity {
  public:
     enum Type : int { NONE, ANT, FOOD };
 
+    // Parameters common to every kind of entity, kept as one plain block
+    struct Params {
+        // Size of the bounding rect that represents Entity
+        Eigen::Vector2d size{5, 5};
+        // Mass of the entity
+        float mass{1.0};
+        // Maximum acceleration possible for Entity
+        float max_acceleration{5e1};
+        // Coefficient of friction (drag)
+        float friction_factor{0};
+        // Maximum radius of vision (0 means the object will see nothing)
+        float vision_distance{0};
+    };
+
     // Default constructor
     Entity() = default;
-    // Default constructor that points to the window to use to display
+    // Default constructor that points to the window to use to display. The
+    // subclasses call place_randomly once their type is known
     Entity(int i, World &world);
     // Constructor that allows placement of the entity
     Entity(int i, World &world, float x, float y, float vx = 0, float vy = 0,
@@ -43,17 +69,24 @@ class Entity {
     // Constructor that allows placement of the entity
     Entity(int i, World &world, Json::Value &&root, float x, float y,
            float vx = 0, float vy = 0, float ax = 0, float ay = 0);
+    // Constructor from a parsed template
+    Entity(int i, World &world, const EntityTemplate &entity_template);
+    // Constructor from a parsed template that allows placement of the entity
+    Entity(int i, World &world, const EntityTemplate &entity_template,
+           float x, float y, float vx = 0, float vy = 0, float ax = 0,
+           float ay = 0);
     // Constructor that allows World-less entity
     Entity(float x, float y, float vx = 0, float vy = 0, float ax = 0,
            float ay = 0);
+    // An entity owns a slot of its store, it cannot be copied
+    Entity(const Entity &) = delete;
+    Entity &operator=(const Entity &) = delete;
 
     // Has to be defined in header to allow auto resolution for World
     template <typename... Ts>
     static auto makeEntity(Type type, Ts &&... params) {
         auto delEntity = [](Entity *pEntity) {
-            std::cerr << "Deleting " << pEntity->type_string() << " "
-                      << pEntity->ent_id << " (" << pEntity->_position(0) << ", "
-                      << pEntity->_position(1) << ")\n";
+            pEntity->log_deletion();
             delete pEntity;
         };
 
@@ -72,16 +105,41 @@ class Entity {
 
         return pEnt;
     }
+    // Same, drawing the entity and its control block from pools and its
+    // kinematic state from a slot of store. Defined in entity_pools.h
+    template <typename... Ts>
+    static std::shared_ptr<Entity> makeEntity(EntityPools &pools,
+                                              EntityStore &store, Type type,
+                                              Ts &&... params);
 
     virtual ~Entity();
 
     // decide where to go by setting acceleration accordingly
     virtual void decision();
 
+    // Set cone to the part of the norm1 ball of vision_distance the entity
+    // can see, and return true if that narrows the neighbour queries
+    virtual bool vision_cone(VisionCone &cone) const;
+
     // update the position according to World::time_step and add shape to
     // renderer for next frame
     void update();
 
+    // Friction acceleration for velocity vel, drag being the friction factor
+    // over the mass. It never more than stops the entity within dt
+    static inline Eigen::Vector2d friction_acceleration(
+        const Eigen::Vector2d &vel, float drag, float dt) {
+        Eigen::Vector2d result = -1 * vel;
+        result.normalize();
+        float vel_norm = vel.norm();
+        float scaling_factor = drag * vel_norm;
+        if (scaling_factor >= vel_norm / dt) {
+            scaling_factor = vel_norm / dt;
+        }
+        result *= scaling_factor;
+        return result;
+    }
+
     // Print debug info about the entity
     void print() const;
 
@@ -100,41 +158,63 @@ class Entity {
         set_color(arg_color[0], arg_color[1], arg_color[2], arg_color[3]);
     }
 
-    inline void set_vision_distance(float d) { _vision_distance = d; }
+    inline void set_vision_distance(float d) { _params.vision_distance = d; }
 
-    inline void clear_neighbours() {
-        // is neighbours.clear(); enough ?
-        for (auto &&neigh : _neighbours) {
-            neigh.reset();
-        }
-        _neighbours.clear();
-    }
+    void clear_neighbours();
 
-    inline auto &neighbours() { return _neighbours; }
+    // Neighbours found by the last World::update_entity_neighbourhoods
+    NeighbourView neighbours() const;
 
-    inline void set_size(float sx, float sy) { _size << sx, sy; }
-    inline void set_mass(float m) { _mass = m; }
-    inline void set_max_acceleration(float m_a) { _max_acceleration = m_a; }
-    inline void set_friction_factor(float f) { _friction_factor = f; }
+    inline void set_size(float sx, float sy) { _params.size << sx, sy; }
+    inline void set_mass(float m) {
+        _params.mass = m;
+        update_drag();
+    }
+    inline void set_max_acceleration(float m_a) {
+        _params.max_acceleration = m_a;
+    }
+    inline void set_friction_factor(float f) {
+        _params.friction_factor = f;
+        update_drag();
+    }
 
     // Accessors
-    inline const Eigen::Vector2d &pos() const { return _position; }
-    inline const Eigen::Vector2d &vel() const { return _velocity; }
-    inline const Eigen::Vector2d &size() const { return _size; }
-    inline const float &mass() const { return _mass; }
+    inline const Eigen::Vector2d &pos() const {
+        return _store->position(_store_slot);
+    }
+    inline const Eigen::Vector2d &vel() const {
+        return _store->velocity(_store_slot);
+    }
+    inline const Eigen::Vector2d &acc() const {
+        return _store->acceleration(_store_slot);
+    }
+    inline const Eigen::Vector2d &size() const { return _params.size; }
+    inline const float &mass() const { return _params.mass; }
     inline const float &max_acceleration() const {
-        return _max_acceleration;
+        return _params.max_acceleration;
+    }
+    inline const float &friction_factor() const {
+        return _params.friction_factor;
     }
-    inline const float &friction_factor() const { return _friction_factor; }
+    inline const Params &params() const { return _params; }
     inline int id() const { return ent_id; }
+    // Index of the entity in the entity list of its World
+    inline std::uint32_t slot() const { return _slot; }
     inline int *color() { return _color; }
     inline Type type() { return _type; }
     std::string type_string() const;
-    inline float vision_distance() const { return _vision_distance; }
-    inline Json::Value json() const { return _json_root; }
+    // Inverse of type_string, NONE for an unknown name
+    static Type type_from_string(const std::string &type);
+    inline float vision_distance() const { return _params.vision_distance; }
 
-    virtual void update_json() const;
-    virtual void read_from_json();
+    // Write the entity to out as a JSON document. Nothing is kept in the
+    // entity, the document is streamed from its fields
+    void write_json(std::ostream &out) const;
+    // Debug message of the deleters of makeEntity
+    void log_deletion() const;
+
+    friend class World;
+    friend class EntityPools;
 
  protected:
     // Type of the entity
@@ -143,28 +223,40 @@ class Entity {
     int ent_id{-1};
     // Pointer to the parent World
     World *parent_world{nullptr};
-    // Size of the bounding rect that represents Entity
-    Eigen::Vector2d _size{5, 5};
-    // Position of the entity
-    Eigen::Vector2d _position{0, 0};
-    // Velocity of the entity
-    Eigen::Vector2d _velocity{0, 0};
-    // Acceleration of the entity
-    Eigen::Vector2d _acceleration{0, 0};
-    // Mass of the entity
-    float _mass{1.0};
-    // Maximum acceleration possible for Entity
-    float _max_acceleration{5e1};
-    // Coefficient of friction (drag)
-    float _friction_factor{0};
+    // Index in the entity list of parent_world
+    std::uint32_t _slot{ENTITY_NO_SLOT};
+    // Store holding the position, velocity and acceleration of the entity
+    EntityStore *_store{&EntityStore::spawn_target()};
+    // Slot of the entity in _store
+    std::uint32_t _store_slot{_store->acquire(this)};
+    // Parameters of the entity
+    Params _params{};
     // Color used to display entity (in hex RGBA)
     int _color[4]{0x44, 0x44, 0x44, 0xFF};
-    // Maximum radius of vision (0 means the object will see nothing)
-    float _vision_distance{0};
-    // List of neighbors that we MAY see within vision_distance
-    std::vector<std::weak_ptr<Entity>> _neighbours{};
-    // Root of JSON for IO
-    mutable Json::Value _json_root{};
+
+    // Mutable accessors to the kinematic state in the store
+    inline Eigen::Vector2d &mut_pos() { return _store->position(_store_slot); }
+    inline Eigen::Vector2d &mut_vel() { return _store->velocity(_store_slot); }
+    inline Eigen::Vector2d &mut_acc() {
+        return _store->acceleration(_store_slot);
+    }
+
+    // Copy the kinematic state to a new slot of store, and give back the
+    // current slot unless release is false (the caller then compacts the
+    // old store itself)
+    void move_to_store(EntityStore &store, bool release = true);
+    // Keep the drag of the store in sync with mass and friction_factor
+    void update_drag();
+    // Put the entity at a random position of the parent world, drawn from
+    // the random stream of its type and id
+    void place_randomly();
+    // Copy the type and parameters of a template
+    void apply_template(const EntityTemplate &entity_template);
+
+    // Write the members of the JSON object of the entity
+    virtual void write_json_fields(JsonWriter &writer) const;
+    // Write the members of the "vision" object of the entity
+    virtual void write_vision_json_fields(JsonWriter &writer) const;
 
     // Compute a linear then quadratic friction acceleration
     Eigen::Vector2d compute_friction_acceleration();
@@ -172,6 +264,89 @@ class Entity {
     Eigen::Vector2d accel_towards(const Eigen::Vector2d &target_velocity);
 };
 
+// View over the neighbour list of an Entity. The list is a row of indices
+// in the shared neighbour table of the World, iterating it yields the
+// neighbouring entities. The view is invalidated by the next computation
+// of the neighbourhoods
+class NeighbourView {
+ public:
+    class iterator {
+     public:
+        iterator(const std::shared_ptr<Entity> *entities,
+                 const std::uint32_t *index)
+            : _entities(entities), _index(index) {}
+        inline Entity &operator*() const { return *_entities[*_index]; }
+        inline Entity *operator->() const { return _entities[*_index].get(); }
+        inline iterator &operator++() {
+            ++_index;
+            return *this;
+        }
+        inline bool operator!=(const iterator &rhs) const {
+            return _index != rhs._index;
+        }
+        inline bool operator==(const iterator &rhs) const {
+            return _index == rhs._index;
+        }
+
+     private:
+        const std::shared_ptr<Entity> *_entities;
+        const std::uint32_t *_index;
+    };
+
+    NeighbourView() = default;
+    NeighbourView(const std::shared_ptr<Entity> *entities,
+                  std::uint32_t *indices, std::uint32_t *count)
+        : _entities(entities), _indices(indices), _count(count) {}
+
+    inline std::size_t size() const { return _count ? *_count : 0; }
+    inline bool empty() const { return size() == 0; }
+    inline iterator begin() const { return {_entities, _indices}; }
+    inline iterator end() const { return {_entities, _indices + size()}; }
+    inline Entity &operator[](std::size_t i) const {
+        return *_entities[_indices[i]];
+    }
+    // Index of the i-th neighbour in the World entity list
+    inline std::uint32_t index(std::size_t i) const { return _indices[i]; }
+
+    // Drop the neighbours for which pred(Entity &) is true, keeping order
+    template <typename Pred>
+    void remove_if(Pred pred) {
+        std::uint32_t kept = 0;
+        for (std::uint32_t i = 0; i < size(); ++i) {
+            if (!pred(*_entities[_indices[i]])) {
+                _indices[kept++] = _indices[i];
+            }
+        }
+        if (_count) {
+            *_count = kept;
+        }
+    }
+
+    // Keep the neighbours i for which seen[i] is set, keeping order
+    void keep(const std::uint8_t *seen) {
+        std::uint32_t kept = 0;
+        for (std::uint32_t i = 0; i < size(); ++i) {
+            if (seen[i]) {
+                _indices[kept++] = _indices[i];
+            }
+        }
+        if (_count) {
+            *_count = kept;
+        }
+    }
+
+    inline void clear() {
+        if (_count) {
+            *_count = 0;
+        }
+    }
+
+ private:
+    const std::shared_ptr<Entity> *_entities{nullptr};
+    std::uint32_t *_indices{nullptr};
+    std::uint32_t *_count{nullptr};
+};
+
 bool operator<(const std::weak_ptr<Entity> &lhs,
                const std::weak_ptr<Entity> &rhs);
 bool operator==(const std::weak_ptr<Entity> &lhs,
@@ -0,0 +1,130 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENTITY_ENTITY_POOLS_H_
+#define ENTITY_ENTITY_POOLS_H_
+#include <memory>
+#include <utility>
+#include "ant/ant.h"
+#include "entity.h"
+#include "food/food.h"
+#include "object_pool.h"
+
+// Handle on an entity of EntityPools, that resolves to nothing once the
+// entity is destroyed, even if its memory was reused since
+struct EntityHandle {
+    Entity::Type type{Entity::Type::NONE};
+    PoolHandle block{};
+};
+
+// One pool of objects and one pool of shared_ptr control blocks per type
+// of entity. Spawning or destroying an entity then costs two pool
+// operations instead of two trips through the global allocator. The
+// entities keep their pools alive, so they may outlive the EntityPools.
+// It is not thread-safe
+class EntityPools {
+ public:
+    EntityPools() = default;
+    EntityPools(const EntityPools &) = delete;
+    EntityPools &operator=(const EntityPools &) = delete;
+
+    // Build an entity of type T, shared with a pooled control block
+    template <typename T, typename... Ts>
+    std::shared_ptr<Entity> make(Ts &&... params) {
+        Pool<T> &pool = pool_of(static_cast<T *>(nullptr));
+        T *object = pool.objects->create(std::forward<Ts>(params)...);
+        // The deleter is called if the control block cannot be allocated
+        return std::shared_ptr<Entity>(object, Deleter<T>{pool.objects},
+                                       PoolAllocator<T>(pool.control_blocks));
+    }
+
+    // Handle on an entity of these pools
+    inline EntityHandle handle(const Entity &entity) const {
+        switch (entity._type) {
+            case (Entity::Type::ANT):
+                return {entity._type, _ants.objects->handle(
+                                          static_cast<const Ant *>(&entity))};
+            case (Entity::Type::FOOD):
+                return {entity._type, _foods.objects->handle(
+                                          static_cast<const Food *>(&entity))};
+            default:
+                return {};
+        }
+    }
+    // Entity of the handle, nullptr if it was destroyed since
+    inline Entity *get(EntityHandle handle) const {
+        switch (handle.type) {
+            case (Entity::Type::ANT):
+                return _ants.objects->get(handle.block);
+            case (Entity::Type::FOOD):
+                return _foods.objects->get(handle.block);
+            default:
+                return nullptr;
+        }
+    }
+
+    // Blocks of the objects of a type
+    inline const SlabPool &objects(Entity::Type type) const {
+        return type == Entity::Type::FOOD ? _foods.objects->blocks()
+                                          : _ants.objects->blocks();
+    }
+    // Blocks of the control blocks of a type
+    inline const SlabPool &control_blocks(Entity::Type type) const {
+        return type == Entity::Type::FOOD ? *_foods.control_blocks
+                                          : *_ants.control_blocks;
+    }
+
+ private:
+    template <typename T>
+    struct Pool {
+        std::shared_ptr<ObjectPool<T>> objects{
+            std::make_shared<ObjectPool<T>>()};
+        // Sized by the first control block
+        std::shared_ptr<SlabPool> control_blocks{std::make_shared<SlabPool>()};
+    };
+
+    // Give the object back to its pool, which it keeps alive until then
+    template <typename T>
+    struct Deleter {
+        std::shared_ptr<ObjectPool<T>> pool;
+        void operator()(T *object) const {
+            object->log_deletion();
+            pool->destroy(object);
+        }
+    };
+
+    inline Pool<Ant> &pool_of(Ant *) { return _ants; }
+    inline Pool<Food> &pool_of(Food *) { return _foods; }
+
+ protected:
+    Pool<Ant> _ants{};
+    Pool<Food> _foods{};
+};
+
+template <typename... Ts>
+std::shared_ptr<Entity> Entity::makeEntity(EntityPools &pools,
+                                           EntityStore &store, Type type,
+                                           Ts &&... params) {
+    EntityStore::SpawnScope scope(store);
+    switch (type) {
+        case (Entity::Type::ANT):
+            return pools.make<Ant>(std::forward<Ts>(params)...);
+        case (Entity::Type::FOOD):
+            return pools.make<Food>(std::forward<Ts>(params)...);
+        default:
+            return nullptr;
+    }
+}
+
+#endif  // ENTITY_ENTITY_POOLS_H_
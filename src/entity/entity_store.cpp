@@ -0,0 +1,105 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "entity_store.h"
+#include <algorithm>
+
+std::uint32_t EntityStore::acquire(Entity *owner) {
+    std::uint32_t slot;
+    if (!_free.empty()) {
+        slot = _free.back();
+        _free.pop_back();
+        _owner[slot] = owner;
+    } else {
+        slot = static_cast<std::uint32_t>(_owner.size());
+        for (int buffer = 0; buffer < 2; ++buffer) {
+            _position[buffer].emplace_back();
+            _velocity[buffer].emplace_back();
+        }
+        _acceleration.emplace_back();
+        _drag.emplace_back();
+        _owner.push_back(owner);
+    }
+    for (int buffer = 0; buffer < 2; ++buffer) {
+        _position[buffer][slot] << 0, 0;
+        _velocity[buffer][slot] << 0, 0;
+    }
+    _acceleration[slot] << 0, 0;
+    _drag[slot] = 0;
+    return slot;
+}
+
+void EntityStore::release(std::uint32_t slot) {
+    _owner[slot] = nullptr;
+    if (slot + 1 == _owner.size()) {
+        for (int buffer = 0; buffer < 2; ++buffer) {
+            _position[buffer].pop_back();
+            _velocity[buffer].pop_back();
+        }
+        _acceleration.pop_back();
+        _drag.pop_back();
+        _owner.pop_back();
+    } else {
+        _free.push_back(slot);
+    }
+}
+
+void EntityStore::swap_remove(std::uint32_t slot) {
+    // The owner may have released the slot already : the last slot is then
+    // gone, any other is taken back from the free list
+    if (slot >= _owner.size()) {
+        return;
+    }
+    if (_owner[slot] == nullptr) {
+        _free.erase(std::find(_free.begin(), _free.end(), slot));
+    }
+    std::size_t last = _owner.size() - 1;
+    if (slot != last) {
+        for (int buffer = 0; buffer < 2; ++buffer) {
+            _position[buffer][slot] = _position[buffer][last];
+            _velocity[buffer][slot] = _velocity[buffer][last];
+        }
+        _acceleration[slot] = _acceleration[last];
+        _drag[slot] = _drag[last];
+        _owner[slot] = _owner[last];
+    }
+    for (int buffer = 0; buffer < 2; ++buffer) {
+        _position[buffer].pop_back();
+        _velocity[buffer].pop_back();
+    }
+    _acceleration.pop_back();
+    _drag.pop_back();
+    _owner.pop_back();
+}
+
+namespace {
+// Store of the innermost SpawnScope of the thread
+thread_local EntityStore *spawn_store = nullptr;
+}  // namespace
+
+EntityStore &EntityStore::detached() {
+    thread_local EntityStore store;
+    return store;
+}
+
+EntityStore &EntityStore::spawn_target() {
+    return spawn_store != nullptr ? *spawn_store : detached();
+}
+
+EntityStore::SpawnScope::SpawnScope(EntityStore &store)
+    : _previous(spawn_store) {
+    spawn_store = &store;
+}
+
+EntityStore::SpawnScope::~SpawnScope() { spawn_store = _previous; }
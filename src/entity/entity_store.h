@@ -0,0 +1,133 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENTITY_ENTITY_STORE_H_
+#define ENTITY_ENTITY_STORE_H_
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include <cstdint>
+#include <vector>
+
+class Entity;
+
+// Structure of arrays holding the kinematic state of entities.
+// An Entity is a view on one slot of a store : its position, velocity,
+// acceleration and drag live in contiguous arrays so that the per-tick
+// loops of World stream through memory instead of visiting every object.
+// A World keeps the slots of its store aligned with its entity list, and
+// the entities it spawns take their slot in it straight away. The other
+// entities use the detached store of the thread that built them.
+//
+// Positions and velocities are double-buffered : the accessors read the
+// front buffer, which stays untouched while a tick computes the back buffer
+// from it. swap_buffers then publishes the new state. Entity decisions can
+// thus read any neighbour in parallel and always see the previous tick
+class EntityStore {
+ public:
+    typedef std::vector<Eigen::Vector2d,
+                        Eigen::aligned_allocator<Eigen::Vector2d>>
+        Vectors;
+
+    EntityStore() = default;
+    EntityStore(const EntityStore &) = delete;
+    EntityStore &operator=(const EntityStore &) = delete;
+
+    // Get a zeroed slot for owner, reusing a released slot if possible
+    std::uint32_t acquire(Entity *owner);
+    // Give back a slot
+    void release(std::uint32_t slot);
+    // Move the state of the last slot (both buffers) into slot and drop the
+    // last slot, keeping the arrays dense. The owner of slot must have left
+    // it already, possibly by releasing it, and the owner of the moved
+    // state must be told its new slot by the caller. Only for stores
+    // without other released slots
+    void swap_remove(std::uint32_t slot);
+
+    // Number of slots (used or not)
+    inline std::size_t size() const { return _owner.size(); }
+    // Entity viewing the slot, nullptr if the slot is free
+    inline Entity *owner(std::uint32_t slot) const { return _owner[slot]; }
+
+    inline Eigen::Vector2d &position(std::uint32_t slot) {
+        return _position[_front][slot];
+    }
+    inline const Eigen::Vector2d &position(std::uint32_t slot) const {
+        return _position[_front][slot];
+    }
+    inline Eigen::Vector2d &velocity(std::uint32_t slot) {
+        return _velocity[_front][slot];
+    }
+    inline const Eigen::Vector2d &velocity(std::uint32_t slot) const {
+        return _velocity[_front][slot];
+    }
+    inline Eigen::Vector2d &acceleration(std::uint32_t slot) {
+        return _acceleration[slot];
+    }
+    inline const Eigen::Vector2d &acceleration(std::uint32_t slot) const {
+        return _acceleration[slot];
+    }
+    // Friction factor over mass
+    inline float &drag(std::uint32_t slot) { return _drag[slot]; }
+    inline float drag(std::uint32_t slot) const { return _drag[slot]; }
+
+    // Whole arrays, for the loops that run over every slot
+    inline const Vectors &positions() const { return _position[_front]; }
+    inline const Vectors &velocities() const { return _velocity[_front]; }
+    inline Vectors &accelerations() { return _acceleration; }
+    inline const std::vector<float> &drags() const { return _drag; }
+    // Back buffers, to be written by a tick before swap_buffers
+    inline Vectors &next_positions() { return _position[1 - _front]; }
+    inline Vectors &next_velocities() { return _velocity[1 - _front]; }
+    // Publish the back buffers as the current state
+    inline void swap_buffers() { _front = 1 - _front; }
+    // Positions before the last tick : after swap_buffers and until the
+    // next tick writes them, the back buffer holds the previous state
+    inline const Vectors &previous_positions() const {
+        return _position[1 - _front];
+    }
+
+    // Store of the entities that live outside of any World, one per thread.
+    // Such an entity has to be destroyed on the thread that built it
+    static EntityStore &detached();
+    // Store a new entity takes its slot from : the store of the innermost
+    // SpawnScope alive on the thread, else the detached store
+    static EntityStore &spawn_target();
+
+    // While alive, the entities built on the thread take their slot from
+    // store instead of the detached store
+    class SpawnScope {
+     public:
+        explicit SpawnScope(EntityStore &store);
+        ~SpawnScope();
+        SpawnScope(const SpawnScope &) = delete;
+        SpawnScope &operator=(const SpawnScope &) = delete;
+
+     private:
+        EntityStore *_previous;
+    };
+
+ protected:
+    // Front and back buffers of positions and velocities
+    Vectors _position[2]{};
+    Vectors _velocity[2]{};
+    // Index of the front buffer
+    int _front{0};
+    Vectors _acceleration{};
+    std::vector<float> _drag{};
+    std::vector<Entity *> _owner{};
+    // Released slots that were not at the end of the arrays
+    std::vector<std::uint32_t> _free{};
+};
+
+#endif  // ENTITY_ENTITY_STORE_H_
@@ -13,37 +13,49 @@
  */
 
 #include "food.h"
+#include "entity/template_registry.h"
 
 Food::Food() : Entity() {
     _type = Entity::Type::FOOD;
-    _mass = 1;
+    set_mass(1);
 }
 
 Food::Food(int i, World &parent_world) : Entity(i, parent_world) {
     _type = Entity::Type::FOOD;
-    _mass = 1;
+    set_mass(1);
+    place_randomly();
 }
 
 Food::Food(int i, World &world, float x, float y, float vx, float vy)
     : Entity(i, world, x, y, vx, vy, 0, 0) {
     _type = Entity::Type::FOOD;
-    _mass = 1;
+    set_mass(1);
 }
 
 Food::Food(int i, World &parent_world, Json::Value &root)
-    : Entity(i, parent_world, std::move(root)) {
-    _mass = 1;
-}
+    : Food(i, parent_world, TemplateRegistry::parse(root)) {}
 
 Food::Food(int i, World &world, Json::Value &root, float x, float y, float vx,
            float vy)
-    : Entity(i, world, std::move(root), x, y, vx, vy, 0, 0) {
-    _mass = 1;
+    : Food(i, world, TemplateRegistry::parse(root), x, y, vx, vy) {}
+
+Food::Food(int i, World &world, const EntityTemplate &entity_template)
+    : Entity(i, world, entity_template) {
+    _type = Entity::Type::FOOD;
+    set_mass(1);
+    place_randomly();
+}
+
+Food::Food(int i, World &world, const EntityTemplate &entity_template,
+           float x, float y, float vx, float vy)
+    : Entity(i, world, entity_template, x, y, vx, vy, 0, 0) {
+    _type = Entity::Type::FOOD;
+    set_mass(1);
 }
 
 Food::Food(float x, float y, float vx, float vy) : Entity(x, y, vx, vy, 0, 0) {
     _type = Entity::Type::FOOD;
-    _mass = 1;
+    set_mass(1);
 }
 
 Food::~Food() {}
@@ -30,6 +30,11 @@ class Food : public Entity {
     // Constructor that allows placement of the entity
     Food(int i, World &world, Json::Value &root, float x, float y,
          float vx = 0, float vy = 0);
+    // Constructor from a parsed template
+    Food(int i, World &world, const EntityTemplate &entity_template);
+    // Constructor from a parsed template that allows placement of the entity
+    Food(int i, World &world, const EntityTemplate &entity_template, float x,
+         float y, float vx = 0, float vy = 0);
     // Constructor that allows World-less food
     Food(float x, float y, float vx = 0, float vy = 0);
 
@@ -0,0 +1,183 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENTITY_JSON_WRITER_H_
+#define ENTITY_JSON_WRITER_H_
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Streaming JSON writer : values go straight to the output stream, nothing
+// is kept in memory but the nesting of the current value. Keys and values
+// must be given in document order
+class JsonWriter {
+ public:
+    explicit JsonWriter(std::ostream &out, int indentation = 3)
+        : _out(out), _indentation(indentation) {}
+
+    inline JsonWriter &begin_object() {
+        open('{');
+        return *this;
+    }
+    inline JsonWriter &end_object() {
+        close('}');
+        return *this;
+    }
+    inline JsonWriter &begin_array() {
+        open('[');
+        return *this;
+    }
+    inline JsonWriter &end_array() {
+        close(']');
+        return *this;
+    }
+
+    // Name of the next member of the current object
+    inline JsonWriter &key(const char *name) {
+        separate();
+        write_string(name);
+        _out << " : ";
+        _after_key = true;
+        return *this;
+    }
+
+    inline JsonWriter &value(int number) {
+        separate();
+        _out << number;
+        return *this;
+    }
+    // Floating point numbers are written with the fewest digits that read
+    // back to the same value
+    inline JsonWriter &value(float number) {
+        separate();
+        write_number(number, 6, 9, [](const char *text, float expected) {
+            return std::strtof(text, nullptr) == expected;
+        });
+        return *this;
+    }
+    inline JsonWriter &value(double number) {
+        separate();
+        write_number(number, 15, 17, [](const char *text, double expected) {
+            return std::strtod(text, nullptr) == expected;
+        });
+        return *this;
+    }
+    inline JsonWriter &value(const std::string &text) {
+        separate();
+        write_string(text.c_str());
+        return *this;
+    }
+    inline JsonWriter &value(const char *text) {
+        separate();
+        write_string(text);
+        return *this;
+    }
+
+    // Shorthand for an array of count values
+    template <typename T>
+    inline JsonWriter &array(const T *values, std::size_t count) {
+        begin_array();
+        for (std::size_t i = 0; i < count; ++i) {
+            value(values[i]);
+        }
+        return end_array();
+    }
+
+ protected:
+    std::ostream &_out;
+    int _indentation;
+    // For each open object or array, true while it is still empty
+    std::vector<bool> _empty{};
+    // True between a key and its value
+    bool _after_key{false};
+
+    // Put what has to come before a new value (or key)
+    inline void separate() {
+        if (_after_key) {
+            _after_key = false;
+            return;
+        }
+        if (_empty.empty()) {
+            return;
+        }
+        if (!_empty.back()) {
+            _out << ',';
+        }
+        _empty.back() = false;
+        new_line();
+    }
+
+    inline void open(char bracket) {
+        separate();
+        _out << bracket;
+        _empty.push_back(true);
+    }
+
+    inline void close(char bracket) {
+        bool was_empty = _empty.back();
+        _empty.pop_back();
+        if (!was_empty) {
+            new_line();
+        }
+        _out << bracket;
+        if (_empty.empty()) {
+            _out << '\n';
+        }
+    }
+
+    inline void new_line() {
+        _out << '\n' << std::string(_empty.size() * _indentation, ' ');
+    }
+
+    inline void write_string(const char *text) {
+        _out << '"';
+        for (const char *c = text; *c != '\0'; ++c) {
+            switch (*c) {
+                case '"':
+                    _out << "\\\"";
+                    break;
+                case '\\':
+                    _out << "\\\\";
+                    break;
+                case '\n':
+                    _out << "\\n";
+                    break;
+                case '\t':
+                    _out << "\\t";
+                    break;
+                default:
+                    _out << *c;
+            }
+        }
+        _out << '"';
+    }
+
+    template <typename T, typename F>
+    inline void write_number(T number, int min_digits, int max_digits,
+                             F reads_back) {
+        char buffer[32];
+        for (int digits = min_digits; digits <= max_digits; ++digits) {
+            std::snprintf(buffer, sizeof(buffer), "%.*g", digits,
+                          static_cast<double>(number));
+            if (reads_back(buffer, number)) {
+                break;
+            }
+        }
+        _out << buffer;
+    }
+};
+
+#endif  // ENTITY_JSON_WRITER_H_
@@ -0,0 +1,73 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "object_pool.h"
+
+SlabPool::SlabPool(std::size_t block_size, std::size_t slab_blocks)
+    : _block_size(block_size), _slab_blocks(slab_blocks > 0 ? slab_blocks : 1) {
+    if (_block_size > 0) {
+        serves(_block_size, POOL_ALIGNMENT);
+    }
+}
+
+bool SlabPool::serves(std::size_t size, std::size_t alignment) {
+    if (alignment > POOL_ALIGNMENT) {
+        return false;
+    }
+    if (_stride == 0) {
+        _block_size = size;
+        _stride = HEADER_SIZE +
+                  (size + POOL_ALIGNMENT - 1) / POOL_ALIGNMENT * POOL_ALIGNMENT;
+        return true;
+    }
+    return size == _block_size;
+}
+
+void *SlabPool::allocate() {
+    std::uint32_t index;
+    if (!_free.empty()) {
+        index = _free.back();
+        _free.pop_back();
+    } else {
+        index = static_cast<std::uint32_t>(_generation.size());
+        if (index % _slab_blocks == 0) {
+            std::size_t words =
+                (_stride * _slab_blocks + sizeof(std::max_align_t) - 1) /
+                sizeof(std::max_align_t);
+            _slabs.emplace_back(new std::max_align_t[words]);
+        }
+        _generation.push_back(0);
+    }
+    unsigned char *block = block_at(index);
+    *header(block) = PoolHandle{index, _generation[index]};
+    ++_live;
+    return block;
+}
+
+void SlabPool::deallocate(void *block) {
+    std::uint32_t index = header(block)->index;
+    // Outstanding handles on the block go stale
+    ++_generation[index];
+    header(block)->index = POOL_NO_INDEX;
+    _free.push_back(index);
+    --_live;
+}
+
+void *SlabPool::get(PoolHandle handle) const {
+    if (handle.index >= _generation.size() ||
+        _generation[handle.index] != handle.generation) {
+        return nullptr;
+    }
+    return block_at(handle.index);
+}
@@ -0,0 +1,194 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENTITY_OBJECT_POOL_H_
+#define ENTITY_OBJECT_POOL_H_
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Number of blocks allocated at once by a SlabPool
+#define POOL_SLAB_BLOCKS 256
+// Alignment of the blocks of a SlabPool
+#define POOL_ALIGNMENT alignof(std::max_align_t)
+// Index of a PoolHandle that points to nothing
+#define POOL_NO_INDEX 0xFFFFFFFFu
+
+// Handle on a block of a SlabPool. The generation of a block changes each
+// time it is given back, so a handle kept after its block was reused
+// resolves to nothing instead of to the new occupant
+struct PoolHandle {
+    std::uint32_t index{POOL_NO_INDEX};
+    std::uint32_t generation{0};
+};
+
+inline bool operator==(const PoolHandle &lhs, const PoolHandle &rhs) {
+    return lhs.index == rhs.index && lhs.generation == rhs.generation;
+}
+inline bool operator!=(const PoolHandle &lhs, const PoolHandle &rhs) {
+    return !(lhs == rhs);
+}
+
+// Allocator of fixed-size blocks. Blocks are carved from slabs of
+// POOL_SLAB_BLOCKS blocks that are never moved nor freed before the pool,
+// and given back blocks go on a free list, so allocate and deallocate are
+// constant-time and a churn of blocks does not fragment the heap.
+// It is not thread-safe
+class SlabPool {
+ public:
+    // A null block_size is fixed by the first call to serves
+    explicit SlabPool(std::size_t block_size = 0,
+                      std::size_t slab_blocks = POOL_SLAB_BLOCKS);
+    SlabPool(const SlabPool &) = delete;
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    // True if the blocks can hold an object of the given size and
+    // alignment. For blocks of any other size, use the global allocator
+    bool serves(std::size_t size, std::size_t alignment);
+
+    // Get a block, reusing a given back one if possible
+    void *allocate();
+    // Give back a block of this pool
+    void deallocate(void *block);
+
+    // Handle on a block in use
+    inline PoolHandle handle(const void *block) const {
+        return *header(block);
+    }
+    // Block of the handle, nullptr if it was given back since
+    void *get(PoolHandle handle) const;
+
+    inline std::size_t block_size() const { return _block_size; }
+    // Number of blocks in use
+    inline std::size_t live() const { return _live; }
+    // Number of blocks allocated from the slabs, in use or not
+    inline std::size_t capacity() const { return _generation.size(); }
+    inline std::size_t slab_count() const { return _slabs.size(); }
+
+ private:
+    // Each block is preceded by a copy of its handle
+    static constexpr std::size_t HEADER_SIZE =
+        (sizeof(PoolHandle) + POOL_ALIGNMENT - 1) / POOL_ALIGNMENT *
+        POOL_ALIGNMENT;
+
+    inline static PoolHandle *header(const void *block) {
+        return reinterpret_cast<PoolHandle *>(
+            const_cast<unsigned char *>(static_cast<const unsigned char *>(
+                block)) -
+            HEADER_SIZE);
+    }
+    inline unsigned char *block_at(std::uint32_t index) const {
+        return reinterpret_cast<unsigned char *>(
+                   _slabs[index / _slab_blocks].get()) +
+               (index % _slab_blocks) * _stride + HEADER_SIZE;
+    }
+
+ protected:
+    std::size_t _block_size;
+    std::size_t _slab_blocks;
+    // Distance between two blocks, header included
+    std::size_t _stride{0};
+    std::vector<std::unique_ptr<std::max_align_t[]>> _slabs{};
+    // Current generation of each block
+    std::vector<std::uint32_t> _generation{};
+    // Indices of the given back blocks
+    std::vector<std::uint32_t> _free{};
+    std::size_t _live{0};
+};
+
+// Pool of objects of type T, built in place in the blocks of a SlabPool
+template <typename T>
+class ObjectPool {
+ public:
+    explicit ObjectPool(std::size_t slab_blocks = POOL_SLAB_BLOCKS)
+        : _blocks(sizeof(T), slab_blocks) {
+        static_assert(alignof(T) <= POOL_ALIGNMENT,
+                      "The pool cannot align this type");
+    }
+
+    template <typename... Ts>
+    T *create(Ts &&... params) {
+        void *block = _blocks.allocate();
+        try {
+            return new (block) T(std::forward<Ts>(params)...);
+        } catch (...) {
+            _blocks.deallocate(block);
+            throw;
+        }
+    }
+    // Destroy an object of create and give its block back
+    inline void destroy(T *object) {
+        object->~T();
+        _blocks.deallocate(object);
+    }
+
+    inline PoolHandle handle(const T *object) const {
+        return _blocks.handle(object);
+    }
+    // Object of the handle, nullptr if it was destroyed since
+    inline T *get(PoolHandle handle) const {
+        return static_cast<T *>(_blocks.get(handle));
+    }
+    inline const SlabPool &blocks() const { return _blocks; }
+
+ protected:
+    SlabPool _blocks;
+};
+
+// Standard allocator drawing single objects from a shared SlabPool, the
+// other requests going to the global allocator. Copies share the pool and
+// keep it alive
+template <typename T>
+class PoolAllocator {
+ public:
+    typedef T value_type;
+
+    explicit PoolAllocator(std::shared_ptr<SlabPool> pool)
+        : _pool(std::move(pool)) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &other) : _pool(other.pool()) {}
+
+    T *allocate(std::size_t n) {
+        if (n == 1 && _pool->serves(sizeof(T), alignof(T))) {
+            return static_cast<T *>(_pool->allocate());
+        }
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T *p, std::size_t n) {
+        if (n == 1 && _pool->serves(sizeof(T), alignof(T))) {
+            _pool->deallocate(p);
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    inline const std::shared_ptr<SlabPool> &pool() const { return _pool; }
+
+ private:
+    std::shared_ptr<SlabPool> _pool;
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> &lhs, const PoolAllocator<U> &rhs) {
+    return lhs.pool() == rhs.pool();
+}
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> &lhs, const PoolAllocator<U> &rhs) {
+    return !(lhs == rhs);
+}
+
+#endif  // ENTITY_OBJECT_POOL_H_
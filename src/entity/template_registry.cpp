@@ -0,0 +1,244 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <dirent.h>
+#include <fstream>
+#include "template_registry.h"
+#include "log/log.h"
+
+namespace {
+void read_color(const Json::Value &color, int result[4]) {
+    if (!color.isArray()) {
+        return;
+    }
+    for (Json::ArrayIndex i = 0; i < 4 && i < color.size(); ++i) {
+        result[i] = color[i].asInt();
+    }
+}
+
+bool has_suffix(const std::string &name, const std::string &suffix) {
+    return name.size() >= suffix.size() &&
+           name.compare(name.size() - suffix.size(), suffix.size(), suffix) ==
+               0;
+}
+}  // namespace
+
+TemplateRegistry::TemplateRegistry(std::string directory)
+    : _directory(std::move(directory)) {}
+
+void TemplateRegistry::set_directory(std::string directory) {
+    _directory = std::move(directory);
+    _failed.clear();
+    _schemas.clear();
+}
+
+const EntityTemplate *TemplateRegistry::get(const std::string &name) {
+    auto found = _templates.find(name);
+    if (found != _templates.end()) {
+        return &found->second;
+    }
+    if (_failed.count(name) > 0) {
+        return nullptr;
+    }
+
+    Json::Value root;
+    if (!read_file(name, root) || !add(name, root)) {
+        _failed.insert(name);
+        return nullptr;
+    }
+    return &_templates[name];
+}
+
+bool TemplateRegistry::add(const std::string &name, const Json::Value &root) {
+    if (!root.isObject()) {
+        LOG_ERROR("TemplateRegistry::add : " << name
+                                              << " is not a JSON object");
+        return false;
+    }
+    Entity::Type type =
+        Entity::type_from_string(root.get("type", "").asString());
+    if (type == Entity::Type::NONE) {
+        LOG_ERROR("TemplateRegistry::add : " << name
+                                              << " has no known type");
+        return false;
+    }
+    const Json::Value &type_schema = schema(type);
+    std::string error;
+    if (!type_schema.isNull() && !validate(root, type_schema, error)) {
+        LOG_ERROR("TemplateRegistry::add : "
+                  << name << " does not match its schema : " << error);
+        return false;
+    }
+
+    _templates[name] = parse(root);
+    _failed.erase(name);
+    return true;
+}
+
+std::size_t TemplateRegistry::preload() {
+    DIR *dir = opendir(_directory.c_str());
+    if (dir == nullptr) {
+        LOG_ERROR("TemplateRegistry::preload : cannot open " << _directory);
+        return 0;
+    }
+    std::size_t loaded = 0;
+    while (struct dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (!has_suffix(name, ".json") || name.compare(0, 7, "schema_") == 0) {
+            continue;
+        }
+        if (get(name) != nullptr) {
+            ++loaded;
+        }
+    }
+    closedir(dir);
+    return loaded;
+}
+
+EntityTemplate TemplateRegistry::parse(const Json::Value &root) {
+    EntityTemplate result;
+    result.type = Entity::type_from_string(root.get("type", "").asString());
+
+    Entity::Params &params = result.params;
+    const Json::Value &size = root["size"];
+    if (size.isArray() && size.size() == 2) {
+        params.size << size[0].asDouble(), size[1].asDouble();
+    }
+    params.mass = root.get("mass", params.mass).asFloat();
+    params.max_acceleration =
+        root.get("max_acceleration", params.max_acceleration).asFloat();
+    params.friction_factor =
+        root.get("friction_factor", params.friction_factor).asFloat();
+    const Json::Value &vision = root["vision"];
+    params.vision_distance =
+        vision.get("distance", params.vision_distance).asFloat();
+
+    Ant::AntParams &ant = result.ant;
+    ant.vision_angle_degrees =
+        vision.get("angle_degrees", ant.vision_angle_degrees).asFloat();
+    ant.cruise_speed = root.get("cruise_speed", ant.cruise_speed).asFloat();
+    ant.separation_potential_exp =
+        root.get("separation_potential_exponent", ant.separation_potential_exp)
+            .asFloat();
+    const Json::Value &weights = root["decision_weights"];
+    ant.cohesion_weight =
+        weights.get("cohesion", ant.cohesion_weight).asFloat();
+    ant.alignment_weight =
+        weights.get("alignment", ant.alignment_weight).asFloat();
+    ant.separation_weight =
+        weights.get("separation", ant.separation_weight).asFloat();
+
+    const Json::Value &colors = root["colors"];
+    read_color(colors["default"], result.default_color);
+    read_color(colors["blind"], result.blind_color);
+    read_color(colors["capped_force"], result.capped_force_color);
+    return result;
+}
+
+bool TemplateRegistry::validate(const Json::Value &value,
+                                const Json::Value &schema, std::string &error,
+                                const std::string &path) {
+    std::string where = path.empty() ? "root" : path;
+    std::string type = schema.get("type", "").asString();
+    if ((type == "object" && !value.isObject()) ||
+        (type == "array" && !value.isArray()) ||
+        (type == "number" && !value.isNumeric()) ||
+        (type == "integer" && !value.isIntegral()) ||
+        (type == "string" && !value.isString())) {
+        error = where + " is not of type " + type;
+        return false;
+    }
+
+    if (value.isNumeric()) {
+        double number = value.asDouble();
+        if ((schema.isMember("minimum") &&
+             number < schema["minimum"].asDouble()) ||
+            (schema.isMember("exclusiveMinimum") &&
+             number <= schema["exclusiveMinimum"].asDouble()) ||
+            (schema.isMember("maximum") &&
+             number > schema["maximum"].asDouble()) ||
+            (schema.isMember("exclusiveMaximum") &&
+             number >= schema["exclusiveMaximum"].asDouble())) {
+            error = where + " is out of bounds";
+            return false;
+        }
+    }
+
+    if (value.isArray()) {
+        if ((schema.isMember("minItems") &&
+             value.size() < schema["minItems"].asUInt()) ||
+            (schema.isMember("maxItems") &&
+             value.size() > schema["maxItems"].asUInt())) {
+            error = where + " has a wrong number of items";
+            return false;
+        }
+        if (schema.isMember("items")) {
+            for (Json::ArrayIndex i = 0; i < value.size(); ++i) {
+                if (!validate(value[i], schema["items"], error,
+                              where + "[" + std::to_string(i) + "]")) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    if (value.isObject()) {
+        for (auto &&required : schema["required"]) {
+            if (!value.isMember(required.asString())) {
+                error = (path.empty() ? "" : path + ".") +
+                        required.asString() + " is missing";
+                return false;
+            }
+        }
+        const Json::Value &properties = schema["properties"];
+        for (auto &&name : properties.getMemberNames()) {
+            if (value.isMember(name) &&
+                !validate(value[name], properties[name], error,
+                          path.empty() ? name : path + "." + name)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool TemplateRegistry::read_file(const std::string &name,
+                                 Json::Value &root) const {
+    std::ifstream file(_directory + name);
+    if (!file.is_open()) {
+        LOG_ERROR("TemplateRegistry : cannot open " << _directory << name);
+        return false;
+    }
+    Json::CharReaderBuilder builder;
+    std::string errors;
+    if (!Json::parseFromStream(builder, file, &root, &errors)) {
+        LOG_ERROR("TemplateRegistry : cannot parse " << name << " : "
+                                                      << errors);
+        return false;
+    }
+    return true;
+}
+
+const Json::Value &TemplateRegistry::schema(Entity::Type type) {
+    auto found = _schemas.find(type);
+    if (found != _schemas.end()) {
+        return found->second;
+    }
+    Json::Value &result = _schemas[type];
+    // Only ants have a schema for now
+    if (type == Entity::Type::ANT) {
+        read_file("schema_ant.json", result);
+    }
+    return result;
+}
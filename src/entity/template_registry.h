@@ -0,0 +1,86 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENTITY_TEMPLATE_REGISTRY_H_
+#define ENTITY_TEMPLATE_REGISTRY_H_
+#include <map>
+#include <set>
+#include <string>
+#include "ant/ant.h"
+#include "entity.h"
+#include "jsoncpp/json/json.h"
+
+// Parameters of an entity template, parsed once from its JSON file.
+// Spawning an entity copies this block instead of reading JSON
+struct EntityTemplate {
+    Entity::Type type{Entity::Type::NONE};
+    Entity::Params params{};
+    // The fields below are only used by ants
+    Ant::AntParams ant{};
+    int default_color[4]{0x22, 0xA0, 0x22, 0xFF};
+    int blind_color[4]{0xA0, 0x22, 0x22, 0xFF};
+    int capped_force_color[4]{0xA0, 0x22, 0xA0, 0xFF};
+};
+
+// Cache of the entity templates of a directory. Each template file is read,
+// checked against the schema of its type (schema_ant.json for ants) and
+// parsed once ; later spawns do no I/O. Pointers to the templates stay valid
+// for the lifetime of the registry. It is not thread-safe
+class TemplateRegistry {
+ public:
+    TemplateRegistry() = default;
+    explicit TemplateRegistry(std::string directory);
+
+    // Directory holding the template files, and their schemas
+    inline const std::string &directory() const { return _directory; }
+    // Change the directory. Templates already loaded are kept
+    void set_directory(std::string directory);
+
+    // Template stored under name, read from directory/name on first use.
+    // Return nullptr if the file cannot be read or is invalid
+    const EntityTemplate *get(const std::string &name);
+    // Validate and store root under name. Return false if root is invalid
+    bool add(const std::string &name, const Json::Value &root);
+    // Load every template file of the directory (the .json files that are
+    // not schemas). Return the number of templates loaded
+    std::size_t preload();
+
+    // Number of templates loaded
+    inline std::size_t size() const { return _templates.size(); }
+
+    // Parse root, falling back to the defaults for missing fields
+    static EntityTemplate parse(const Json::Value &root);
+    // Check value against schema. Only a subset of JSON schema is supported :
+    // type, properties, required, items, minItems, maxItems, minimum,
+    // maximum, exclusiveMinimum and exclusiveMaximum. On failure, error
+    // tells which field is wrong
+    static bool validate(const Json::Value &value, const Json::Value &schema,
+                         std::string &error, const std::string &path = "");
+
+ protected:
+    std::string _directory{};
+    // std::map keeps the addresses of the templates stable
+    std::map<std::string, EntityTemplate> _templates{};
+    // Names that could not be loaded, so they are not read again
+    std::set<std::string> _failed{};
+    // Schemas by entity type, null when the type has no schema
+    std::map<Entity::Type, Json::Value> _schemas{};
+
+    // Read a JSON file of the directory into root
+    bool read_file(const std::string &name, Json::Value &root) const;
+    // Schema of type, loaded on first use
+    const Json::Value &schema(Entity::Type type);
+};
+
+#endif  // ENTITY_TEMPLATE_REGISTRY_H_
@@ -0,0 +1,111 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Run the simulation as fast as possible, without any window, and report
+// how long each phase of World::update took
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "FlockingConfig.h"
+#include "log/log.h"
+#include "world/world.h"
+
+#define DEFAULT_TICKS 1000
+#define DEFAULT_SEED 0
+#define TIME_STEP (1.0 / 60)
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        LOG_ERROR("Usage : "
+                  << argv[0]
+                  << " EVENTS_FILE [TICKS] [SEED] [THREADS] [PROFILE_FILE]");
+        LOG_ERROR("  TICKS defaults to "
+                  << DEFAULT_TICKS << ", SEED to " << DEFAULT_SEED
+                  << ", THREADS to 1 (0 uses every hardware thread)");
+        LOG_ERROR("  PROFILE_FILE receives the phase timings, as JSON if "
+                  "its name ends with .json and as CSV otherwise");
+        return 1;
+    }
+    std::string events_path = argv[1];
+    long ticks = DEFAULT_TICKS;
+    std::uint64_t seed = DEFAULT_SEED;
+    unsigned threads = 1;
+    try {
+        if (argc > 2) {
+            ticks = std::stol(argv[2]);
+        }
+        if (argc > 3) {
+            seed = std::stoull(argv[3]);
+        }
+        if (argc > 4) {
+            threads = std::stoul(argv[4]);
+        }
+    } catch (const std::logic_error& e) {
+        LOG_ERROR("Invalid argument : " << e.what());
+        return 1;
+    }
+
+    std::fstream events_file;
+    events_file.open(events_path, std::ios::in);
+    if (!events_file.is_open()) {
+        LOG_ERROR("Cannot open events file " << events_path);
+        return 1;
+    }
+
+    World world;
+    world.set_time_step(TIME_STEP);
+    world.set_seed(seed);
+    world.set_thread_count(threads);
+    world.preload_templates();
+    world.add_events(events_file);
+
+    auto start = std::chrono::steady_clock::now();
+    for (long tick = 0; tick < ticks; ++tick) {
+        world.update();
+    }
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    std::cout << "Flocking_SDL version " << Flocking_VERSION_MAJOR << "."
+              << Flocking_VERSION_MINOR << " headless\n";
+    std::cout << "entities " << world.entity_list().size() << " ticks "
+              << ticks << " threads " << world.thread_count() << " seed "
+              << seed << "\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "elapsed_s " << elapsed << " ticks_per_s "
+              << (elapsed > 0 ? ticks / elapsed : 0) << "\n";
+    const Profiler& profiler = world.profiler();
+    std::cout << "phase total_ms mean_ms p50_ms p99_ms max_ms (last "
+              << profiler.window() << " ticks)\n";
+    for (std::size_t phase = 0; phase < profiler.phase_count(); ++phase) {
+        Profiler::Stats stats = profiler.stats(phase);
+        std::cout << profiler.phase_name(phase) << " "
+                  << 1e3 * profiler.total(phase) << " " << 1e3 * stats.mean
+                  << " " << 1e3 * stats.p50 << " " << 1e3 * stats.p99 << " "
+                  << 1e3 * stats.max << "\n";
+    }
+
+    if (argc > 5) {
+        if (!profiler.dump(argv[5])) {
+            LOG_ERROR("Cannot write profile to " << argv[5]);
+            return 1;
+        }
+    }
+    return 0;
+}
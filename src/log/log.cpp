@@ -0,0 +1,256 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+const char *level_prefix(LogLevel level) {
+    switch (level) {
+        case (LogLevel::LEVEL_DEBUG):
+            return "[debug] ";
+        case (LogLevel::LEVEL_WARNING):
+            return "[warning] ";
+        case (LogLevel::LEVEL_ERROR):
+            return "[error] ";
+        case (LogLevel::LEVEL_INFO):
+        default:
+            return "";
+    }
+}
+
+std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Gives the ring back when its thread ends
+struct RingOwner {
+    LogRing *ring{nullptr};
+    ~RingOwner() {
+        if (ring != nullptr) {
+            ring->owned.store(false, std::memory_order_release);
+        }
+    }
+};
+thread_local RingOwner ring_owner;
+}  // namespace
+
+bool LogRing::try_push(const LogRecord &record) {
+    std::uint64_t tail = _tail.load(std::memory_order_relaxed);
+    std::uint64_t head = _head.load(std::memory_order_acquire);
+    if (tail - head == _records.size()) {
+        return false;
+    }
+    LogRecord &slot = _records[tail % _records.size()];
+    slot.time = record.time;
+    slot.level = record.level;
+    slot.size = record.size;
+    std::memcpy(slot.text, record.text, record.size);
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+Logger &Logger::instance() {
+    // Never destroyed, so that static destructors can still log
+    static Logger *logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger() : _sink(&std::cerr) {
+    _drain_thread = std::thread(&Logger::run, this);
+    std::atexit([] { Logger::instance().shutdown(); });
+}
+
+void Logger::set_sink(std::ostream *sink) {
+    std::lock_guard<std::mutex> lock(_sink_mutex);
+    drain();
+    _sink = sink != nullptr ? sink : &std::cerr;
+}
+
+LogRing &Logger::ring() {
+    if (ring_owner.ring != nullptr) {
+        return *ring_owner.ring;
+    }
+    std::lock_guard<std::mutex> lock(_rings_mutex);
+    for (auto &&ring : _rings) {
+        bool owned = false;
+        if (ring->owned.compare_exchange_strong(owned, true,
+                                                std::memory_order_acquire)) {
+            ring_owner.ring = ring.get();
+            return *ring;
+        }
+    }
+    _rings.emplace_back(new LogRing());
+    _rings.back()->owned.store(true, std::memory_order_relaxed);
+    ring_owner.ring = _rings.back().get();
+    return *ring_owner.ring;
+}
+
+void Logger::push(const LogRecord &record) {
+    if (_stopped.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(_sink_mutex);
+        write(record);
+        _sink->flush();
+        return;
+    }
+    if (!ring().try_push(record)) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Logger::flush() {
+    std::lock_guard<std::mutex> lock(_sink_mutex);
+    drain();
+}
+
+void Logger::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(_stop_mutex);
+        if (_stop) {
+            return;
+        }
+        _stop = true;
+    }
+    _stop_signal.notify_one();
+    _drain_thread.join();
+    std::lock_guard<std::mutex> lock(_sink_mutex);
+    _stopped.store(true, std::memory_order_release);
+    // Messages pushed before _stopped was seen
+    drain();
+}
+
+void Logger::drain() {
+    std::vector<LogRing *> rings;
+    {
+        std::lock_guard<std::mutex> lock(_rings_mutex);
+        for (auto &&ring : _rings) {
+            rings.push_back(ring.get());
+        }
+    }
+    _batch.clear();
+    for (LogRing *ring : rings) {
+        ring->drain([this](const LogRecord &record) {
+            _batch.push_back(record);
+        });
+    }
+    // Each ring is in order, interleave the threads
+    std::stable_sort(_batch.begin(), _batch.end(),
+                     [](const LogRecord &lhs, const LogRecord &rhs) {
+                         return lhs.time < rhs.time;
+                     });
+    for (const LogRecord &record : _batch) {
+        write(record);
+    }
+
+    std::uint64_t dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != _reported_drops) {
+        *_sink << level_prefix(LogLevel::LEVEL_WARNING) << "Logger : "
+               << dropped - _reported_drops
+               << " message(s) dropped, the rings were full\n";
+        _reported_drops = dropped;
+    }
+    if (!_batch.empty()) {
+        _sink->flush();
+    }
+}
+
+void Logger::write(const LogRecord &record) {
+    *_sink << level_prefix(record.level);
+    _sink->write(record.text, record.size);
+    *_sink << '\n';
+}
+
+void Logger::run() {
+    std::unique_lock<std::mutex> stop_lock(_stop_mutex);
+    while (!_stop) {
+        _stop_signal.wait_for(stop_lock,
+                              std::chrono::milliseconds(LOG_DRAIN_PERIOD_MS));
+        stop_lock.unlock();
+        flush();
+        stop_lock.lock();
+    }
+}
+
+LogLine::LogLine(LogLevel level) {
+    _record.level = level;
+    _record.time = now_ns();
+}
+
+LogLine::~LogLine() {
+    // Messages end with a new line of their own
+    while (_record.size > 0 && _record.text[_record.size - 1] == '\n') {
+        --_record.size;
+    }
+    Logger::instance().push(_record);
+}
+
+void LogLine::append(const char *text, std::size_t size) {
+    std::size_t room = LOG_RECORD_SIZE - _record.size;
+    if (size > room) {
+        size = room;
+    }
+    std::memcpy(_record.text + _record.size, text, size);
+    _record.size += static_cast<std::uint32_t>(size);
+}
+
+LogLine &LogLine::operator<<(const char *text) {
+    if (text == nullptr) {
+        text = "(null)";
+    }
+    append(text, std::strlen(text));
+    return *this;
+}
+
+LogLine &LogLine::operator<<(const std::string &text) {
+    append(text.data(), text.size());
+    return *this;
+}
+
+LogLine &LogLine::operator<<(char c) {
+    append(&c, 1);
+    return *this;
+}
+
+LogLine &LogLine::operator<<(bool value) {
+    return *this << (value ? "true" : "false");
+}
+
+LogLine &LogLine::operator<<(long long value) {
+    char text[24];
+    int size = std::snprintf(text, sizeof(text), "%lld", value);
+    append(text, static_cast<std::size_t>(size));
+    return *this;
+}
+
+LogLine &LogLine::operator<<(unsigned long long value) {
+    char text[24];
+    int size = std::snprintf(text, sizeof(text), "%llu", value);
+    append(text, static_cast<std::size_t>(size));
+    return *this;
+}
+
+LogLine &LogLine::operator<<(double value) {
+    // Same output as the default formatting of std::ostream
+    char text[32];
+    int size = std::snprintf(text, sizeof(text), "%g", value);
+    append(text, static_cast<std::size_t>(size));
+    return *this;
+}
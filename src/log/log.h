@@ -0,0 +1,262 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOG_LOG_H_
+#define LOG_LOG_H_
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+// Messages below this level are compiled out, their arguments are not even
+// evaluated. Define it before including this header (or with -D) to change
+// it
+#ifndef FLOCKS_MIN_LOG_LEVEL
+#ifdef NDEBUG
+#define FLOCKS_MIN_LOG_LEVEL LOG_LEVEL_INFO
+#else
+#define FLOCKS_MIN_LOG_LEVEL LOG_LEVEL_DEBUG
+#endif  // NDEBUG
+#endif  // FLOCKS_MIN_LOG_LEVEL
+
+// Level of the logger until set_level is called. Debug messages, like the
+// one of every entity deletion, are compiled in debug builds but only shown
+// once asked for : call set_level, or define it to LOG_LEVEL_DEBUG when
+// building the logger library
+#ifndef LOG_DEFAULT_LEVEL
+#define LOG_DEFAULT_LEVEL LOG_LEVEL_INFO
+#endif  // LOG_DEFAULT_LEVEL
+
+// Number of messages a thread can have waiting for the drain
+#define LOG_RING_CAPACITY 1024
+// Longest message, longer ones are truncated
+#define LOG_RECORD_SIZE 240
+// Time between two drains of the rings by the background thread
+#define LOG_DRAIN_PERIOD_MS 10
+
+// The enumerators are prefixed, DEBUG and ERROR being common macros
+enum class LogLevel : int {
+    LEVEL_DEBUG = LOG_LEVEL_DEBUG,
+    LEVEL_INFO = LOG_LEVEL_INFO,
+    LEVEL_WARNING = LOG_LEVEL_WARNING,
+    LEVEL_ERROR = LOG_LEVEL_ERROR
+};
+
+// One formatted message
+struct LogRecord {
+    // Nanoseconds on the steady clock
+    std::int64_t time{0};
+    LogLevel level{LogLevel::LEVEL_INFO};
+    std::uint32_t size{0};
+    char text[LOG_RECORD_SIZE];
+};
+
+// Single-producer single-consumer ring of records : the thread owning the
+// ring pushes without locking, the drain thread pops
+class LogRing {
+ public:
+    LogRing() : _records(LOG_RING_CAPACITY) {}
+
+    // Copy the record in the ring, false if the ring is full. Only called
+    // by the owner of the ring
+    bool try_push(const LogRecord &record);
+    // Call f(const LogRecord &) for each record in the ring, oldest first,
+    // and free them. Only called by the drain
+    template <typename F>
+    std::size_t drain(F &&f) {
+        std::uint64_t head = _head.load(std::memory_order_relaxed);
+        std::uint64_t tail = _tail.load(std::memory_order_acquire);
+        for (std::uint64_t i = head; i < tail; ++i) {
+            f(_records[i % _records.size()]);
+        }
+        _head.store(tail, std::memory_order_release);
+        return tail - head;
+    }
+
+    // True while a thread pushes in the ring. Rings of finished threads are
+    // taken over by new threads
+    std::atomic<bool> owned{false};
+
+ protected:
+    std::vector<LogRecord> _records;
+    // Next record to pop, and next record to push
+    std::atomic<std::uint64_t> _head{0};
+    std::atomic<std::uint64_t> _tail{0};
+};
+
+// Logger of the whole program. Logging a message formats it on the calling
+// thread into its own ring, which costs no lock nor system call ; a
+// background thread drains the rings to the sink. Messages that find their
+// ring full are dropped and counted. Pending messages are written when the
+// program exits
+class Logger {
+ public:
+    // The one logger, never destroyed
+    static Logger &instance();
+
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    // Messages below level are ignored. LOG_DEFAULT_LEVEL by default
+    inline void set_level(LogLevel level) {
+        _level.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+    inline LogLevel level() const {
+        return static_cast<LogLevel>(_level.load(std::memory_order_relaxed));
+    }
+    inline bool enabled(LogLevel level) const {
+        return static_cast<int>(level) >=
+               _level.load(std::memory_order_relaxed);
+    }
+    // Stream receiving the messages, std::cerr if nullptr. The logger is
+    // flushed first
+    void set_sink(std::ostream *sink);
+
+    // Queue a message of the calling thread
+    void push(const LogRecord &record);
+    // Write every queued message now
+    void flush();
+    // Stop the background thread after a last drain. Later messages are
+    // written directly
+    void shutdown();
+
+    // Number of messages dropped because their ring was full
+    inline std::uint64_t dropped() const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+ private:
+    Logger();
+
+    // Ring of the calling thread
+    LogRing &ring();
+    // Drain every ring to the sink, the caller holding _sink_mutex
+    void drain();
+    void write(const LogRecord &record);
+    void run();
+
+ protected:
+    std::atomic<int> _level{LOG_DEFAULT_LEVEL};
+    std::atomic<std::uint64_t> _dropped{0};
+    // Dropped messages already reported
+    std::uint64_t _reported_drops{0};
+
+    std::mutex _rings_mutex{};
+    std::vector<std::unique_ptr<LogRing>> _rings{};
+
+    // Held while writing to the sink
+    std::mutex _sink_mutex{};
+    std::ostream *_sink;
+    // Records of a drain, sorted by time before being written
+    std::vector<LogRecord> _batch{};
+
+    std::mutex _stop_mutex{};
+    std::condition_variable _stop_signal{};
+    bool _stop{false};
+    std::atomic<bool> _stopped{false};
+    std::thread _drain_thread{};
+};
+
+// Message being formatted, queued when the line is destroyed
+class LogLine {
+ public:
+    explicit LogLine(LogLevel level);
+    ~LogLine();
+    LogLine(const LogLine &) = delete;
+    LogLine &operator=(const LogLine &) = delete;
+
+    LogLine &operator<<(const char *text);
+    LogLine &operator<<(const std::string &text);
+    LogLine &operator<<(char c);
+    LogLine &operator<<(bool value);
+    LogLine &operator<<(long long value);
+    LogLine &operator<<(unsigned long long value);
+    LogLine &operator<<(double value);
+    // Every other integer goes through the 64 bits overloads
+    template <typename T, typename std::enable_if<std::is_integral<T>::value,
+                                                  int>::type = 0>
+    LogLine &operator<<(T value) {
+        if (std::is_signed<T>::value) {
+            return *this << static_cast<long long>(value);
+        }
+        return *this << static_cast<unsigned long long>(value);
+    }
+    inline LogLine &operator<<(float value) {
+        return *this << static_cast<double>(value);
+    }
+    // Anything else that can be streamed
+    template <typename T, typename std::enable_if<!std::is_arithmetic<T>::value,
+                                                  int>::type = 0>
+    LogLine &operator<<(const T &value) {
+        std::ostringstream text;
+        text << value;
+        return *this << text.str();
+    }
+
+ private:
+    void append(const char *text, std::size_t size);
+
+    LogRecord _record{};
+};
+
+#define FLOCKS_LOG(level, message)                     \
+    do {                                               \
+        if (Logger::instance().enabled(level)) {       \
+            LogLine(level) << message;                 \
+        }                                              \
+    } while (0)
+
+#if FLOCKS_MIN_LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(message) FLOCKS_LOG(LogLevel::LEVEL_DEBUG, message)
+#else
+#define LOG_DEBUG(message) \
+    do {                   \
+    } while (0)
+#endif
+#if FLOCKS_MIN_LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(message) FLOCKS_LOG(LogLevel::LEVEL_INFO, message)
+#else
+#define LOG_INFO(message) \
+    do {                  \
+    } while (0)
+#endif
+#if FLOCKS_MIN_LOG_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(message) FLOCKS_LOG(LogLevel::LEVEL_WARNING, message)
+#else
+#define LOG_WARNING(message) \
+    do {                     \
+    } while (0)
+#endif
+#if FLOCKS_MIN_LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(message) FLOCKS_LOG(LogLevel::LEVEL_ERROR, message)
+#else
+#define LOG_ERROR(message) \
+    do {                   \
+    } while (0)
+#endif
+
+#endif  // LOG_LOG_H_
@@ -13,14 +13,21 @@
  */
 
 #include <SDL2/SDL.h>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "FlockingConfig.h"
 #include "entity/entity.h"
+#include "log/log.h"
 #include "ui/input/user_input.h"
 #include "ui/window/mainwindow.h"
+#include "world/fixed_timestep.h"
 #include "world/world.h"
 
 #ifndef NDEBUG
@@ -33,16 +40,27 @@
 #define WINDOW_HEIGHT 960
 #define ANT_COUNT 60
 #define FRAMERATE 60
+// Updates per simulated second, independent of the frame rate
+#define PHYSICS_RATE 60
+// Most updates run at once when the simulation is late
+#define MAX_CATCH_UP_TICKS 5
+
+// Seconds of the steady clock, the time base of RenderFrame::due
+static double steady_seconds() {
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
 
 int main(int argc, char* argv[]) {
-    std::cerr << "Flocking_SDL version " << Flocking_VERSION_MAJOR << "."
-              << Flocking_VERSION_MINOR << "\n";
+    LOG_INFO("Flocking_SDL version " << Flocking_VERSION_MAJOR << "."
+                                     << Flocking_VERSION_MINOR);
 
-    std::cerr << argc << " argument(s) -> ";
+    std::string arguments;
     for (int i = 0; i < argc; ++i) {
-        std::cerr << argv[i] << " ";
+        arguments += std::string(argv[i]) + " ";
     }
-    std::cerr << std::endl;
+    LOG_INFO(argc << " argument(s) -> " << arguments);
 
     World world;
     MainWindow main_window(WINDOW_WIDTH, WINDOW_HEIGHT, world);
@@ -53,18 +71,21 @@ int main(int argc, char* argv[]) {
     if (!(main_window.has_correct_init() &&
           main_window.load_media_bg(DATA_DIR "bg.png") &&
           main_window.load_texture(DATA_DIR "bg.png"))) {
-        std::cerr << "Problem during window initalization !\n";
+        LOG_ERROR("Problem during window initalization !");
         return 1;
     }
 
     // Initialize time variables
     float frame_in_ms = 1000.0f / FRAMERATE;
-    world.set_time_step(frame_in_ms/1000.0);
+    world.set_time_step(1.0 / PHYSICS_RATE);
 
     // Initialize game loop variables
     bool quit = false;
     SDL_Event e;
 
+    // Read the entity templates once, spawning then does no I/O
+    world.preload_templates();
+
     if (argc <= 1) {
         for (int i = 0; i < ANT_COUNT; ++i) {
             world.add_entity(Entity::Type::ANT);
@@ -76,6 +97,34 @@ int main(int argc, char* argv[]) {
         world.add_events(events_file);
     }
 
+    // The simulation runs on its own thread with a fixed time step and
+    // publishes a frame after each batch of updates. SDL wants the window
+    // and the events on the main thread, which draws the latest frame at
+    // the display rate, interpolated between its last two states. Neither
+    // side waits for the other
+    TripleBuffer<RenderFrame> frames;
+    world.detach_render_window();
+    world.set_frame_buffer(&frames);
+    world.publish_frame(steady_seconds());
+    std::atomic<bool> stop_simulation{false};
+    std::thread simulation([&world, &stop_simulation]() {
+        FixedTimestep timestep(world.time_step(), MAX_CATCH_UP_TICKS);
+        double last = steady_seconds();
+        while (!stop_simulation.load(std::memory_order_relaxed)) {
+            double now = steady_seconds();
+            int steps = timestep.advance(now - last);
+            last = now;
+            for (int i = 0; i < steps; ++i) {
+                world.update();
+            }
+            if (steps > 0) {
+                world.publish_frame(now - timestep.accumulator());
+            }
+            std::this_thread::sleep_for(
+                std::chrono::duration<double>(timestep.time_to_next_step()));
+        }
+    });
+
     while (!quit) {
         float start_ms = SDL_GetTicks();
         while (SDL_PollEvent(&e) != 0) {
@@ -86,13 +135,15 @@ int main(int argc, char* argv[]) {
 
         // Update the canvas
         main_window.clear_and_draw_bg();
-        world.update();
+        frames.update();
+        const RenderFrame &frame = frames.front();
+        main_window.draw_frame(frame, frame.alpha(steady_seconds()));
         main_window.update();
 
         // Limit Framerate
         float dura_ms = SDL_GetTicks() - start_ms;
 #ifndef NDEBUG
-        std::cerr << "Duration : " << dura_ms << "\n";
+        LOG_DEBUG("Duration : " << dura_ms);
         ++hist[std::floor(dura_ms)];
 #endif  // NDEBUG
         float delay_ms = frame_in_ms - dura_ms;
@@ -100,15 +151,23 @@ int main(int argc, char* argv[]) {
             SDL_Delay(delay_ms);
         }
     }
+    stop_simulation.store(true, std::memory_order_relaxed);
+    simulation.join();
 #ifndef NDEBUG
     int hist_scale(100);
-    std::cerr << "Each star is " << hist_scale << " frames\n";
+    LOG_DEBUG("Each star is " << hist_scale << " frames");
     for (auto p : hist) {
-        std::cerr << std::fixed << std::setprecision(1) << std::setw(2)
-                  << p.first << ' ' << std::string(p.second / hist_scale, '*')
-                  << '\n';
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1) << std::setw(2) << p.first
+             << ' ' << std::string(p.second / hist_scale, '*');
+        LOG_DEBUG(line.str());
     }
 #endif  // NDEBUG
 
+    // Optional second argument : file receiving the update phase timings
+    if (argc > 2 && !world.profiler().dump(argv[2])) {
+        LOG_ERROR("Cannot write profile to " << argv[2]);
+    }
+
     return 0;
 }
@@ -15,6 +15,36 @@
 #include <algorithm>
 #include "FlockingConfig.h"
 #include "json_event.h"
+#include "log/log.h"
+
+namespace {
+// Parse the text of one element of an "events" array
+bool parse_event_text(Json::CharReader& reader, const std::string& text,
+                      Json::Value& event) {
+    std::string errors;
+    if (!reader.parse(text.data(), text.data() + text.size(), &event,
+                      &errors)) {
+        LOG_WARNING("WorldEventsList : Skipping an invalid event : "
+                    << errors);
+        return false;
+    }
+    return true;
+}
+
+// Call visit on each event an element of an "events" array describes
+template <typename F>
+void for_each_event_in_json(const Json::Value& event, F&& visit) {
+    float time_stamp = event["time_stamp"].asFloat();
+
+    if (event["creation"]) {
+        visit(std::make_shared<CreationEvent>(time_stamp, event["creation"]));
+    }
+    if (event["destruction"]) {
+        visit(std::make_shared<DestructionEvent>(time_stamp,
+                                                 event["destruction"]));
+    }
+}
+}  // namespace
 
 WorldEventsList::WorldEventsList(std::string file_name) {
 
@@ -26,7 +56,7 @@ WorldEventsList::WorldEventsList(std::string file_name) {
     json_stream.open(std::string(DATA_DIR) + "events/" + file_name,
                      std::ios::in);
     if (!json_stream.is_open()) {
-        std::cerr << "Error while opening " << file_name << "\n";
+        LOG_ERROR("Error while opening " << file_name);
         return;
     }
 
@@ -46,28 +76,162 @@ void WorldEventsList::read_istream(std::istream& in, bool append) {
 }
 
 void WorldEventsList::construct_from_json(const Json::Value& root) {
-    _list.clear();
+    clear();
     append_from_json(root);
 }
 
 void WorldEventsList::append_from_json(const Json::Value& root) {
     // We don't check for "events" key since it's the responsibility of
     // a (hypothetic) schema validator
-    const Json::Value events = root["events"];
+    const Json::Value& events = root["events"];
     for (unsigned int i = 0; i < events.size(); ++i) {
-        float time_stamp = events[i]["time_stamp"].asFloat();
+        append_event_from_json(events[i]);
+    }
+}
+
+void WorldEventsList::append_event_from_json(const Json::Value& event) {
+    for_each_event_in_json(event, [this](std::shared_ptr<WorldEvent>&& e) {
+        append(std::move(e));
+    });
+}
+
+void WorldEventsList::stream_istream(std::unique_ptr<std::istream> in) {
+    clear();
+    _stream = std::move(in);
+    _streamed = true;
+    if (!find_events_array()) {
+        LOG_ERROR("WorldEventsList::stream_istream : No \"events\" array "
+                  "in the stream");
+        _stream.reset();
+    }
+}
 
-        if (events[i]["creation"]) {
-            _list.emplace_back(std::make_shared<CreationEvent>(
-                time_stamp, events[i]["creation"]));
-            _sorted_list = false;
+bool WorldEventsList::stream_file(const std::string& path) {
+    std::unique_ptr<std::ifstream> file(new std::ifstream(path));
+    if (!file->is_open()) {
+        LOG_ERROR("Error while opening " << path);
+        return false;
+    }
+    stream_istream(std::move(file));
+    return true;
+}
+
+void WorldEventsList::pull_until(float time_stamp) {
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    std::string text;
+    while (_stream && _last_pulled < time_stamp) {
+        if (!next_event_text(text)) {
+            _stream.reset();
+            break;
         }
-        if (events[i]["destruction"]) {
-            _list.emplace_back(std::make_shared<DestructionEvent>(
-                time_stamp, events[i]["destruction"]));
-            _sorted_list = false;
+        Json::Value event;
+        if (!parse_event_text(*reader, text, event)) {
+            continue;
         }
+        float event_time = event["time_stamp"].asFloat();
+        if (event_time < _last_pulled) {
+            LOG_WARNING("WorldEventsList::pull_until : Streamed event at "
+                        << event_time << " is not sorted, it may be missed");
+        } else {
+            _last_pulled = event_time;
+        }
+        append_event_from_json(event);
+    }
+}
+
+bool WorldEventsList::find_events_array() {
+    // Walk the top-level object, only keeping track of strings and nesting,
+    // until the "events" key
+    int depth = 0;
+    bool events_key = false;
+    char c;
+    while (_stream->get(c)) {
+        if (c == '"') {
+            std::string key;
+            while (_stream->get(c) && c != '"') {
+                if (c == '\\') {
+                    _stream->get(c);
+                }
+                key += c;
+            }
+            events_key = depth == 1 && key == "events";
+        } else if (c == '[' && depth == 1 && events_key) {
+            return true;
+        } else if (c == '{' || c == '[') {
+            ++depth;
+            events_key = false;
+        } else if (c == '}' || c == ']') {
+            --depth;
+            events_key = false;
+        } else if (c == ',') {
+            events_key = false;
+        }
+    }
+    return false;
+}
+
+bool WorldEventsList::next_event_text(std::string& text) {
+    text.clear();
+    char c;
+    // Skip to the next object, or to the end of the array
+    while (_stream->get(c) && c != '{') {
+        if (c == ']') {
+            return false;
+        }
+    }
+    if (!*_stream) {
+        return false;
+    }
+    text += c;
+    int depth = 1;
+    bool in_string = false;
+    while (depth > 0 && _stream->get(c)) {
+        text += c;
+        if (in_string) {
+            if (c == '\\' && _stream->get(c)) {
+                text += c;
+            } else if (c == '"') {
+                in_string = false;
+            }
+        } else if (c == '"') {
+            in_string = true;
+        } else if (c == '{' || c == '[') {
+            ++depth;
+        } else if (c == '}' || c == ']') {
+            --depth;
+        }
+    }
+    return depth == 0;
+}
+
+void WorldEventsList::drop_served_events() {
+    // Erase in chunks, so each event is moved a bounded number of times
+    if (_cursor < 1024 || _cursor * 2 < _list.size()) {
+        return;
+    }
+    _list.erase(_list.begin(), _list.begin() + _cursor);
+    _cursor = 0;
+}
+
+void WorldEventsList::append(std::shared_ptr<WorldEvent> event) {
+    // Appending in time order keeps a sorted list sorted. An event before
+    // the last served frame must go before the cursor
+    if ((!_list.empty() && event->time_stamp() < _list.back()->time_stamp()) ||
+        event->time_stamp() < _served_until) {
+        _sorted_list = false;
     }
+    _list.emplace_back(std::move(event));
+}
+
+void WorldEventsList::clear() {
+    _list.clear();
+    _sorted_list = false;
+    _cursor = 0;
+    _served_until = -std::numeric_limits<float>::infinity();
+    _stream.reset();
+    _streamed = false;
+    _last_pulled = -std::numeric_limits<float>::infinity();
 }
 
 void WorldEventsList::sort_events_list() {
@@ -75,8 +239,61 @@ void WorldEventsList::sort_events_list() {
         return;
     }
 
-    std::sort(_list.begin(), _list.end());
+    // Events of a same time_stamp keep their order of insertion
+    std::stable_sort(_list.begin(), _list.end(),
+                     [](const std::shared_ptr<WorldEvent>& lhs,
+                        const std::shared_ptr<WorldEvent>& rhs) {
+                         return lhs->time_stamp() < rhs->time_stamp();
+                     });
     _sorted_list = true;
+    // Events added before the end of the last served frame are in the past
+    seek_sorted(_served_until);
+}
+
+void WorldEventsList::for_each_pending(
+    const std::function<void(const std::shared_ptr<WorldEvent>&)>& visit) {
+    std::istream::pos_type start(-1);
+    if (_stream) {
+        start = _stream->tellg();
+        if (start == std::istream::pos_type(-1)) {
+            pull_all();
+        }
+    }
+    sort_events_list();
+    for (std::size_t i = _cursor; i < _list.size(); ++i) {
+        visit(_list[i]);
+    }
+    if (!_stream) {
+        return;
+    }
+
+    // Read ahead, then put the stream back where the next pull expects it
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    std::string text;
+    while (next_event_text(text)) {
+        Json::Value event;
+        if (parse_event_text(*reader, text, event)) {
+            for_each_event_in_json(event, visit);
+        }
+    }
+    _stream->clear();
+    _stream->seekg(start);
+}
+
+void WorldEventsList::seek(float time_stamp) {
+    sort_events_list();
+    seek_sorted(time_stamp);
+    _served_until = time_stamp;
+}
+
+void WorldEventsList::seek_sorted(float time_stamp) {
+    _cursor = std::lower_bound(_list.begin(), _list.end(), time_stamp,
+                               [](const std::shared_ptr<WorldEvent>& event,
+                                  float time) {
+                                   return event->time_stamp() < time;
+                               }) -
+              _list.begin();
 }
 
 WorldEventsList::~WorldEventsList() { _list.clear(); }
@@ -88,12 +305,13 @@ std::vector<std::weak_ptr<WorldEvent>> WorldEventsList::events_in_time_frame(
         sort_events_list();
     }
 
-    auto first_event = std::find_if(_list.begin(), _list.end(), [&](auto item) {
-        return item->time_stamp() >= interval_start;
-    });
-    auto last_event = std::find_if(first_event, _list.end(), [&](auto item) {
-        return item->time_stamp() >= interval_end;
-    });
+    auto before = [](const std::shared_ptr<WorldEvent>& event, float time) {
+        return event->time_stamp() < time;
+    };
+    auto first_event =
+        std::lower_bound(_list.begin(), _list.end(), interval_start, before);
+    auto last_event =
+        std::lower_bound(first_event, _list.end(), interval_end, before);
 
     result.insert(result.begin(), first_event, last_event);
 
@@ -126,6 +344,13 @@ CreationEvent::CreationEvent(float& time_stamp, const Json::Value& root)
     }
 }
 
+CreationEvent::CreationEvent(float time_stamp, std::string template_name)
+    : CreationEvent() {
+    _is_creation = true;
+    _time_stamp = time_stamp;
+    _template_name = std::move(template_name);
+}
+
 CreationEvent::~CreationEvent() {}
 
 DestructionEvent::DestructionEvent(float& time_stamp, const Json::Value& root)
@@ -136,6 +361,15 @@ DestructionEvent::DestructionEvent(float& time_stamp, const Json::Value& root)
     _id = root["id"].asInt();
 }
 
+DestructionEvent::DestructionEvent(float time_stamp, std::string entity_type,
+                                   int id)
+    : DestructionEvent() {
+    _is_destruction = true;
+    _time_stamp = time_stamp;
+    _entity_type = std::move(entity_type);
+    _id = id;
+}
+
 DestructionEvent::~DestructionEvent() {}
 
 bool operator<(const std::shared_ptr<WorldEvent>& lhs,
@@ -15,8 +15,12 @@
 #ifndef UI_INPUT_JSONEVENT_H
 #define UI_INPUT_JSONEVENT_H
 #include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -63,6 +67,24 @@ class WorldEventsList {
     void append_from_json(const Json::Value& root);
     //! istream 'constructor' helper
     void read_istream(std::istream& in, bool append = false);
+    //! Appends one event without duplicate checking
+    void append(std::shared_ptr<WorldEvent> event);
+    //! Remove every event
+    void clear();
+
+    //! Read the events lazily from a stream instead of parsing them all up
+    //  front : they are pulled from the "events" array as serve needs them.
+    //  The streamed events must be sorted by time_stamp. Served events are
+    //  then dropped from the list, so memory stays bounded
+    void stream_istream(std::unique_ptr<std::istream> in);
+    //! Stream the events of a file, return false if it cannot be opened
+    bool stream_file(const std::string& path);
+    //! True while events remain to be pulled from a stream
+    inline bool is_streaming() const { return _stream != nullptr; }
+    //! Pull every event left in the stream
+    inline void pull_all() {
+        pull_until(std::numeric_limits<float>::infinity());
+    }
 
     // Accessor
     auto inline list() const { return _list; }
@@ -72,6 +94,52 @@ class WorldEventsList {
     std::vector<std::weak_ptr<WorldEvent>> events_in_time_frame(
         float interval_start, float interval_end);
 
+    //! Call serve(const std::shared_ptr<WorldEvent>&) for each event between
+    //  a starting time_stamp (inclusive) and an ending time_stamp
+    //  (exclusive) that was not served yet, and return their number.
+    //  Events are served once : a cursor remembers the end of the last
+    //  served frame, so the cost only depends on the number of events
+    //  served. A frame starts where the last one ended, so rounding can not
+    //  leave a gap between two frames : interval_start only matters for the
+    //  first frame (or the first one after seek), events before it are
+    //  skipped
+    template <typename F>
+    std::size_t serve(float interval_start, float interval_end, F&& serve) {
+        if (_stream) {
+            pull_until(interval_end);
+        }
+        sort_events_list();
+        float start = std::isinf(_served_until) ? interval_start
+                                                : _served_until;
+        std::size_t served = 0;
+        while (_cursor < _list.size() &&
+               _list[_cursor]->time_stamp() < interval_end) {
+            if (_list[_cursor]->time_stamp() >= start) {
+                serve(_list[_cursor]);
+                ++served;
+            }
+            ++_cursor;
+        }
+        _served_until = std::max(_served_until, interval_end);
+        if (_streamed) {
+            drop_served_events();
+        }
+        return served;
+    }
+
+    //! Call visit(const std::shared_ptr<WorldEvent>&) for each event that
+    //  was not served yet, without pulling the stream : its events are read
+    //  ahead and the stream is put back. A stream that cannot seek is
+    //  pulled to the end instead
+    void for_each_pending(
+        const std::function<void(const std::shared_ptr<WorldEvent>&)>& visit);
+
+    //! Put the cursor before the first event at or after time_stamp, so
+    //  serve starts from there
+    void seek(float time_stamp);
+    //! Index in list() of the next event to serve
+    inline std::size_t cursor() const { return _cursor; }
+
     ~WorldEventsList();
 
  protected:
@@ -79,16 +147,57 @@ class WorldEventsList {
 
     //! Mark if list is already time sorted
     bool _sorted_list{false};
+    //! Index of the first event not served yet, in the sorted list
+    std::size_t _cursor{0};
+    //! End of the last served time frame
+    float _served_until{-std::numeric_limits<float>::infinity()};
+
+    //! Stream the events are pulled from, if any
+    std::unique_ptr<std::istream> _stream{};
+    //! Mark if events came from a stream, which allows dropping them once
+    //  served
+    bool _streamed{false};
+    //! time_stamp of the last event pulled from the stream
+    float _last_pulled{-std::numeric_limits<float>::infinity()};
 
     void sort_events_list();
+    //! Put the cursor before the first event at or after time_stamp, the
+    //  list being sorted
+    void seek_sorted(float time_stamp);
+    //! Append one element of an "events" array
+    void append_event_from_json(const Json::Value& event);
+    //! Pull events from the stream until one is at or after time_stamp, or
+    //  the stream ends
+    void pull_until(float time_stamp);
+    //! Move the stream after the '[' of the "events" array
+    bool find_events_array();
+    //! Read the text of the next object of the "events" array
+    bool next_event_text(std::string& text);
+    //! Forget the events before the cursor
+    void drop_served_events();
 };
 
 class CreationEvent : public WorldEvent {
  public:
     CreationEvent() = default;
     CreationEvent(float& time_stamp, const Json::Value& root);
+    //! Constructor for a creation at a random location
+    CreationEvent(float time_stamp, std::string template_name);
     ~CreationEvent();
 
+    inline void set_pos(const Eigen::Vector2d& pos) {
+        _has_position = true;
+        _pos = pos;
+    }
+    inline void set_vel(const Eigen::Vector2d& vel) {
+        _has_velocity = true;
+        _vel = vel;
+    }
+    inline void set_acc(const Eigen::Vector2d& acc) {
+        _has_acceleration = true;
+        _acc = acc;
+    }
+
     inline std::string json_template_name() const { return _template_name; }
     inline const Eigen::Vector2d& pos() const { return _pos; }
     inline const Eigen::Vector2d& vel() const { return _vel; }
@@ -116,8 +225,12 @@ class DestructionEvent : public WorldEvent {
  public:
     DestructionEvent() = default;
     DestructionEvent(float& time_stamp, const Json::Value& root);
+    DestructionEvent(float time_stamp, std::string entity_type, int id);
     ~DestructionEvent();
 
+    inline const std::string& entity_type() const { return _entity_type; }
+    inline int id() const { return _id; }
+
  protected:
     //! "type" json_field -> links to a typeString()
     std::string _entity_type{""};
@@ -12,7 +12,9 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cmath>
 #include "mainwindow.h"
+#include "log/log.h"
 #include "world/world.h"
 
 SDL_Surface *MainWindow::g_bg_surface = NULL;
@@ -27,8 +29,7 @@ MainWindow::MainWindow(int width, int height, World &world)
       success(true) {
     // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        std::cerr << "SDL could not initialize! SDL Error: " << SDL_GetError()
-                  << "\n";
+        LOG_ERROR("SDL could not initialize! SDL Error: " << SDL_GetError());
         success = false;
     } else {
         // Create window
@@ -36,8 +37,8 @@ MainWindow::MainWindow(int width, int height, World &world)
                                    SDL_WINDOWPOS_UNDEFINED, width, height,
                                    SDL_WINDOW_SHOWN);
         if (gWindow == NULL) {
-            std::cerr << "Window could not be created! SDL Error: "
-                      << SDL_GetError() << "\n";
+            LOG_ERROR("Window could not be created! SDL Error: "
+                      << SDL_GetError());
             success = false;
         } else {
             // Create renderer for window
@@ -45,8 +46,8 @@ MainWindow::MainWindow(int width, int height, World &world)
                 SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED);
             if (gRenderer == NULL) {
                 success = false;
-                std::cerr << "Renderer could not be created ! SDL Error: "
-                          << SDL_GetError() << "\n";
+                LOG_ERROR("Renderer could not be created ! SDL Error: "
+                          << SDL_GetError());
             } else {
                 // Initialise Renderer color
                 SDL_SetRenderDrawColor(gRenderer, bg_render_color[0],
@@ -55,9 +56,9 @@ MainWindow::MainWindow(int width, int height, World &world)
                 // Initialise PNG Loading
                 int img_flags = IMG_INIT_PNG;
                 if (!(IMG_Init(img_flags) & img_flags)) {
-                    std::cerr
-                        << "SDL_image could not initialize! SDL_image Error: "
-                        << IMG_GetError() << "\n";
+                    LOG_ERROR(
+                        "SDL_image could not initialize! SDL_image Error: "
+                        << IMG_GetError());
                     success = false;
                 } else {
                     // Get window surface
@@ -77,15 +78,15 @@ bool MainWindow::load_media_bg(std::string path) {
     SDL_Surface *loadedSurface = IMG_Load(path.c_str());
     if (loadedSurface == NULL) {
         success = false;
-        std::cerr << "Unable to load image " << path
-                  << "! SDL Error: " << IMG_GetError() << "\n";
+        LOG_ERROR("Unable to load image " << path
+                                          << "! SDL Error: " << IMG_GetError());
     } else {
         // Convert surface to screen format
         g_bg_surface =
             SDL_ConvertSurface(loadedSurface, gScreenSurface->format, 0);
         if (g_bg_surface == NULL) {
-            std::cerr << "Unable to optimize image " << path
-                      << "! SDL Error: " << SDL_GetError() << "\n";
+            LOG_ERROR("Unable to optimize image "
+                      << path << "! SDL Error: " << SDL_GetError());
         }
 
         // Get rid of old loaded surface
@@ -102,14 +103,14 @@ bool MainWindow::load_texture(std::string path) {
     SDL_Surface *loadedSurface = IMG_Load(path.c_str());
     if (loadedSurface == NULL) {
         success = false;
-        std::cerr << "Unable to load image " << path
-                  << "! SDL Error: " << IMG_GetError() << "\n";
+        LOG_ERROR("Unable to load image " << path
+                                          << "! SDL Error: " << IMG_GetError());
     } else {
         // Convert surface to texture
         gTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
         if (gTexture == NULL) {
-            std::cerr << "Unable to create texture from " << path
-                      << "! SDL Error: " << SDL_GetError() << "\n";
+            LOG_ERROR("Unable to create texture from "
+                      << path << "! SDL Error: " << SDL_GetError());
         }
 
         // Get rid of old loaded surface
@@ -132,6 +133,67 @@ void MainWindow::add_DrawRect_to_renderer(int w0, int h0, int w_total,
     SDL_RenderDrawRect(gRenderer, &outlineRect);
 }
 
+void MainWindow::begin_batch() {
+    for (auto &bucket : _buckets) {
+        bucket.rects.clear();
+    }
+}
+
+void MainWindow::add_FillRect_to_batch(int w0, int h0, int w_total,
+                                       int h_total, int color[4]) {
+    std::uint32_t rgba = (color[0] & 0xFF) << 24 | (color[1] & 0xFF) << 16 |
+                         (color[2] & 0xFF) << 8 | (color[3] & 0xFF);
+    if (_last_bucket >= _buckets.size() ||
+        _buckets[_last_bucket].rgba != rgba) {
+        _last_bucket = 0;
+        while (_last_bucket < _buckets.size() &&
+               _buckets[_last_bucket].rgba != rgba) {
+            ++_last_bucket;
+        }
+        if (_last_bucket == _buckets.size()) {
+            _buckets.push_back({rgba, {}});
+        }
+    }
+    _buckets[_last_bucket].rects.push_back({w0, h0, w_total, h_total});
+}
+
+void MainWindow::end_batch() {
+    for (const auto &bucket : _buckets) {
+        if (bucket.rects.empty()) {
+            continue;
+        }
+        SDL_SetRenderDrawColor(gRenderer, bucket.rgba >> 24,
+                               (bucket.rgba >> 16) & 0xFF,
+                               (bucket.rgba >> 8) & 0xFF, bucket.rgba & 0xFF);
+        SDL_RenderFillRects(gRenderer, bucket.rects.data(),
+                            static_cast<int>(bucket.rects.size()));
+    }
+}
+
+void MainWindow::draw_frame(const RenderFrame &frame, float alpha) {
+    if (frame.world_width <= 0 || frame.world_height <= 0) {
+        return;
+    }
+    int width, height;
+    SDL_GetWindowSize(gWindow, &width, &height);
+    float scale_x = static_cast<float>(width) / frame.world_width;
+    float scale_y = static_cast<float>(height) / frame.world_height;
+
+    begin_batch();
+    for (const auto &item : frame.items) {
+        int color[4] = {item.color[0], item.color[1], item.color[2],
+                        item.color[3]};
+        float x = RenderFrame::interpolate(item.previous_x, item.x, alpha,
+                                           frame.world_width);
+        float y = RenderFrame::interpolate(item.previous_y, item.y, alpha,
+                                           frame.world_height);
+        add_FillRect_to_batch(std::floor(x * scale_x), std::floor(y * scale_y),
+                              std::floor(item.width * scale_x),
+                              std::floor(item.height * scale_y), color);
+    }
+    end_batch();
+}
+
 void MainWindow::clear_and_draw_bg() {
     // Reset Render color
     SDL_SetRenderDrawColor(gRenderer, bg_render_color[0], bg_render_color[1],
@@ -147,9 +209,9 @@ void MainWindow::clear_and_draw_bg() {
     int width, height;
     SDL_GetWindowSize(gWindow, &width, &height);
 
-    // Set the px width and height accordingly to scale World properly
-    displayed_world->_height_in_px = height;
-    displayed_world->_width_in_px = width;
+    // Scale the World to the window, from its next update since it may be
+    // updating on the simulation thread
+    displayed_world->set_window_size(width, height);
 
     int c_blue[4] = {0x22, 0x22, 0xFF, 0xFF};
     add_FillRect_to_renderer(width / 4, height / 4, width / 2, height / 2,
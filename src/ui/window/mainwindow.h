@@ -16,12 +16,15 @@
 #define UI_WINDOW_MAINWINDOW_H
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#include <cstdint>
 #include <iostream>
 #include <string>
+#include <vector>
+#include "world/render_target.h"
 
 class World;
 // Class that encapsulates SDL Renderer and display window
-class MainWindow {
+class MainWindow : public RenderTarget {
  public:
     // Default constructor has 2 parameters for the size of the window in pixels
     MainWindow(int width, int height, World &world);
@@ -29,12 +32,22 @@ class MainWindow {
 
     // Add a FillRect of given color to the renderer for the next frame
     void add_FillRect_to_renderer(int w0, int h0, int w_total, int h_total,
-                                  int color[4]);
+                                  int color[4]) override;
     // Add a DrawRect (outline only) of given color to the renderer for the next
     // frame
     void add_DrawRect_to_renderer(int w0, int h0, int w_total, int h_total,
                                   int color[4]);
 
+    // Render batch : rects are put in one bucket per color, and end_batch
+    // draws each bucket with a single SDL_RenderFillRects call
+    void begin_batch() override;
+    void add_FillRect_to_batch(int w0, int h0, int w_total, int h_total,
+                               int color[4]) override;
+    void end_batch() override;
+    // Draw every item of a frame as one batch, scaled to the window, at
+    // alpha between their previous (0) and current (1) positions
+    void draw_frame(const RenderFrame &frame, float alpha = 1);
+
     // Load a picture into the global SDL_Surface g_bg_surface
     bool load_media_bg(std::string path);
     // Load a picture into the texture gTexture
@@ -64,6 +77,17 @@ class MainWindow {
     int bg_render_color[4];
     // Marks the success of the initialization in construction
     bool success;
+
+    // Rects of one color waiting for end_batch
+    struct ColorBucket {
+        std::uint32_t rgba;
+        std::vector<SDL_Rect> rects;
+    };
+    // Buckets of the batch. They are kept between frames so a steady-state
+    // frame does not allocate
+    std::vector<ColorBucket> _buckets{};
+    // Bucket of the last added rect, consecutive rects often share a color
+    std::size_t _last_bucket{0};
 };
 
 #endif  // UI_WINDOW_MAINWINDOW_H
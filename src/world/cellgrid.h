@@ -0,0 +1,324 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLD_CELLGRID_H_
+#define WORLD_CELLGRID_H_
+
+#define GRID_TOT_DIM 2
+#define GRID_DEFAULT_CELL_SIZE 125.0
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "world/vision_cone.h"
+
+// A 2 dimensional uniform grid of square cells (a cell list).
+// Entities are bucketed by cell with a counting sort, so each cell is a
+// contiguous range of one array. Queries whose radius is about the cell size
+// only look at a handful of cells. It answers the same queries as the
+// bulk-built KDTree
+template <typename T>  // T has a pos method that returns a Vector
+                       // implementing operator()
+class CellGrid {
+ public:
+    CellGrid() = default;
+
+    // Set the length of the side of a cell, ideally the query radius
+    inline void set_cell_size(double size) {
+        if (size > 0) {
+            _cell_size = size;
+        }
+    }
+
+    // Make the coordinates wrap around [0 ; width[ x [0 ; height[ for the
+    // periodic queries. A null size leaves that dimension unbounded
+    inline void set_periodic_domain(double width, double height) {
+        _period[0] = width;
+        _period[1] = height;
+    }
+
+    // Bucket count entities starting at first. The arrays are kept between
+    // builds, so a steady-state rebuild does not allocate. The source array
+    // must outlive the queries on the grid.
+    void build(const std::shared_ptr<T>* first, std::size_t count);
+    inline void build(const std::vector<std::shared_ptr<T>>& entities) {
+        build(entities.data(), entities.size());
+    }
+
+    // Number of entities in the grid
+    inline std::size_t size() const { return _entries.size(); }
+    // Number of cells in the given dimension
+    inline int cell_count(int dim) const { return _count[dim]; }
+
+    // Append to result the index of each entity that lies in the norm1 ball
+    inline void norm1_range_query(const Eigen::Vector2d& center, float radius,
+                                  std::vector<std::uint32_t>& result) const {
+        norm1_range_visit(center, radius,
+                          [&](std::uint32_t index) { result.push_back(index); });
+    }
+
+    // Call visit(index) for each entity that lies in the norm1 ball, index
+    // being its position in the array given to build. The domain is not
+    // wrapped around
+    template <typename F>
+    void norm1_range_visit(const Eigen::Vector2d& center, float radius,
+                           F&& visit) const {
+        if (radius == 0 || _entries.empty()) {
+            return;
+        }
+        float pos_rad = std::abs(radius);
+        double min[GRID_TOT_DIM] = {center(0) - pos_rad, center(1) - pos_rad};
+        double max[GRID_TOT_DIM] = {center(0) + pos_rad, center(1) + pos_rad};
+        int first[GRID_TOT_DIM];
+        int last[GRID_TOT_DIM];
+        for (int dim = 0; dim < GRID_TOT_DIM; ++dim) {
+            first[dim] = std::max(0, cell_coord(min[dim], dim));
+            last[dim] = std::min(_count[dim] - 1, cell_coord(max[dim], dim));
+        }
+
+        for (int j = first[1]; j <= last[1]; ++j) {
+            for (int i = first[0]; i <= last[0]; ++i) {
+                std::size_t cell = static_cast<std::size_t>(j) * _count[0] + i;
+                for (std::uint32_t k = _cell_start[cell];
+                     k < _cell_start[cell + 1]; ++k) {
+                    const Entry& entry = _entries[k];
+                    if (min[0] <= entry.x && entry.x <= max[0] &&
+                        min[1] <= entry.y && entry.y <= max[1]) {
+                        visit(entry.index);
+                    }
+                }
+            }
+        }
+    }
+
+    // Call visit(index, offset) exactly once for each entity that lies in
+    // the norm1 ball on the periodic domain, offset being the minimum image
+    // vector going from center to the entity
+    template <typename F>
+    inline void periodic_range_visit(const Eigen::Vector2d& center,
+                                     float radius, F&& visit) const {
+        if (radius == 0) {
+            return;
+        }
+        periodic_visit(center, std::abs(radius), nullptr, visit);
+    }
+
+    // Call visit(index, offset) exactly once for each entity that
+    // cone.contains on the periodic domain, offset being the minimum image
+    // vector going from the apex to the entity. The cells that miss the cone
+    // are not looked at
+    template <typename F>
+    inline void periodic_cone_visit(const VisionCone& cone, F&& visit) const {
+        if (cone.radius <= 0) {
+            return;
+        }
+        periodic_visit(cone.apex, cone.radius, &cone, visit);
+    }
+
+    // Empty the grid. The arrays keep their capacity
+    inline void clean() {
+        _entries.clear();
+        _cell_start.clear();
+        _count[0] = 0;
+        _count[1] = 0;
+    }
+
+ private:
+    struct Entry {
+        double x;
+        double y;
+        // Index of the entity in the array given to build
+        std::uint32_t index;
+    };
+
+    // Walk of the cells covering the norm1 ball on the periodic domain. With
+    // a cone, the cells missing it are skipped and the entities are tested
+    // against it
+    template <typename F>
+    void periodic_visit(const Eigen::Vector2d& center, double pos_rad,
+                        const VisionCone* cone, F& visit) const {
+        if (_entries.empty()) {
+            return;
+        }
+        double wrapped_center[GRID_TOT_DIM];
+        int first[GRID_TOT_DIM];
+        int span[GRID_TOT_DIM];
+        bool prune = cone != nullptr;
+        for (int dim = 0; dim < GRID_TOT_DIM; ++dim) {
+            double c = center(dim);
+            if (_period[dim] > 0) {
+                c -= _period[dim] * std::floor(c / _period[dim]);
+            }
+            wrapped_center[dim] = c;
+            int lo = cell_coord(c - pos_rad, dim);
+            int hi = cell_coord(c + pos_rad, dim);
+            if (_period[dim] <= 0) {
+                lo = std::max(0, lo);
+                hi = std::min(_count[dim] - 1, hi);
+            }
+            // Never look twice at the same cell
+            first[dim] = lo;
+            span[dim] = std::min(hi - lo + 1, _count[dim]);
+            // When the cells span the whole period, a cell may hold images
+            // of the entities on both sides of the center
+            if (_period[dim] > 0 && hi - lo + 1 >= _count[dim]) {
+                prune = false;
+            }
+        }
+
+        for (int dj = 0; dj < span[1]; ++dj) {
+            int j = wrap_cell(first[1] + dj, 1);
+            for (int di = 0; di < span[0]; ++di) {
+                int i = wrap_cell(first[0] + di, 0);
+                if (prune) {
+                    // Cell seen from the center, before wrapping around
+                    double low[GRID_TOT_DIM] = {
+                        cell_low(first[0] + di, 0) - wrapped_center[0],
+                        cell_low(first[1] + dj, 1) - wrapped_center[1]};
+                    double high[GRID_TOT_DIM] = {
+                        low[0] + _cell_width[0], low[1] + _cell_width[1]};
+                    if (!cone->may_intersect(low, high)) {
+                        continue;
+                    }
+                }
+                std::size_t cell = static_cast<std::size_t>(j) * _count[0] + i;
+                for (std::uint32_t k = _cell_start[cell];
+                     k < _cell_start[cell + 1]; ++k) {
+                    const Entry& entry = _entries[k];
+                    Eigen::Vector2d offset(
+                        minimum_image(entry.x - wrapped_center[0], 0),
+                        minimum_image(entry.y - wrapped_center[1], 1));
+                    if (cone != nullptr ? cone->contains(offset)
+                                        : std::abs(offset(0)) <= pos_rad &&
+                                              std::abs(offset(1)) <= pos_rad) {
+                        visit(entry.index, offset);
+                    }
+                }
+            }
+        }
+    }
+
+    // Cell coordinate of a position in the given dimension, not clamped
+    inline int cell_coord(double position, int dim) const {
+        return static_cast<int>(std::floor((position - _origin[dim]) /
+                                           _cell_width[dim]));
+    }
+
+    // Lower bound of a cell coordinate in the given dimension
+    inline double cell_low(int cell, int dim) const {
+        return _origin[dim] + cell * _cell_width[dim];
+    }
+
+    inline int wrap_cell(int cell, int dim) const {
+        if (_period[dim] <= 0) {
+            return cell;
+        }
+        cell %= _count[dim];
+        return cell < 0 ? cell + _count[dim] : cell;
+    }
+
+    inline double minimum_image(double delta, int dim) const {
+        double period = _period[dim];
+        if (period <= 0) {
+            return delta;
+        }
+        if (delta > period / 2) {
+            return delta - period;
+        } else if (delta < -period / 2) {
+            return delta + period;
+        }
+        return delta;
+    }
+
+ protected:
+    double _cell_size{GRID_DEFAULT_CELL_SIZE};
+    // Size of the periodic domain in each dimension, 0 when unbounded
+    double _period[GRID_TOT_DIM]{0, 0};
+    // Lower corner of the grid
+    double _origin[GRID_TOT_DIM]{0, 0};
+    // Actual width of a cell in each dimension (>= _cell_size so the cells
+    // tile the periodic domain)
+    double _cell_width[GRID_TOT_DIM]{GRID_DEFAULT_CELL_SIZE,
+                                     GRID_DEFAULT_CELL_SIZE};
+    // Number of cells in each dimension
+    int _count[GRID_TOT_DIM]{0, 0};
+    // Entities of cell c are _entries[_cell_start[c] ; _cell_start[c + 1][
+    std::vector<std::uint32_t> _cell_start{};
+    std::vector<Entry> _entries{};
+    // Cell of each entity, scratch space for the counting sort
+    std::vector<std::uint32_t> _cell_of{};
+};
+
+template <typename T>
+void CellGrid<T>::build(const std::shared_ptr<T>* first, std::size_t count) {
+    _entries.resize(count);
+    _cell_of.resize(count);
+
+    for (int dim = 0; dim < GRID_TOT_DIM; ++dim) {
+        if (_period[dim] > 0) {
+            _origin[dim] = 0;
+            _count[dim] = std::max(
+                1, static_cast<int>(std::floor(_period[dim] / _cell_size)));
+            _cell_width[dim] = _period[dim] / _count[dim];
+        } else {
+            double lowest = std::numeric_limits<double>::max();
+            double highest = std::numeric_limits<double>::lowest();
+            for (std::size_t i = 0; i < count; ++i) {
+                lowest = std::min(lowest, first[i]->pos()(dim));
+                highest = std::max(highest, first[i]->pos()(dim));
+            }
+            _origin[dim] = count > 0 ? lowest : 0;
+            _cell_width[dim] = _cell_size;
+            _count[dim] =
+                count > 0 ? 1 + static_cast<int>(std::floor(
+                                    (highest - lowest) / _cell_size))
+                          : 1;
+        }
+    }
+
+    std::size_t cell_total = static_cast<std::size_t>(_count[0]) * _count[1];
+    _cell_start.assign(cell_total + 1, 0);
+
+    // Counting sort : histogram, exclusive prefix sum, then scatter
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto& position = first[i]->pos();
+        int cx = std::min(_count[0] - 1,
+                          std::max(0, cell_coord(position(0), 0)));
+        int cy = std::min(_count[1] - 1,
+                          std::max(0, cell_coord(position(1), 1)));
+        _cell_of[i] = static_cast<std::uint32_t>(cy) * _count[0] + cx;
+        ++_cell_start[_cell_of[i] + 1];
+    }
+    for (std::size_t cell = 0; cell < cell_total; ++cell) {
+        _cell_start[cell + 1] += _cell_start[cell];
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto& position = first[i]->pos();
+        // _cell_start[c] serves as the insertion cursor of cell c
+        std::uint32_t slot = _cell_start[_cell_of[i]]++;
+        _entries[slot] = {position(0), position(1),
+                          static_cast<std::uint32_t>(i)};
+    }
+    // The cursors ended one cell too far, shift them back
+    for (std::size_t cell = cell_total; cell > 0; --cell) {
+        _cell_start[cell] = _cell_start[cell - 1];
+    }
+    _cell_start[0] = 0;
+}
+
+#endif  // WORLD_CELLGRID_H_
@@ -0,0 +1,70 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLD_FIXED_TIMESTEP_H_
+#define WORLD_FIXED_TIMESTEP_H_
+#include <algorithm>
+#include <cstdint>
+
+#define FIXED_TIMESTEP_DEFAULT_MAX_CATCH_UP 5
+
+// Accumulator of a fixed-timestep loop. Elapsed wall-clock time is added
+// to the accumulator, and each whole step in it is one update to run, so
+// the simulation keeps a constant time step whatever the loop rate. When
+// the loop falls too far behind, at most max_catch_up steps are run at
+// once and the rest of the backlog is dropped : the simulation then runs
+// slower than real time instead of spiralling
+class FixedTimestep {
+ public:
+    explicit FixedTimestep(
+        double step, int max_catch_up = FIXED_TIMESTEP_DEFAULT_MAX_CATCH_UP)
+        : _step(step), _max_catch_up(std::max(1, max_catch_up)) {}
+
+    // Add elapsed seconds, and return the number of steps to run now, in
+    // [0 ; max_catch_up]
+    inline int advance(double elapsed) {
+        _accumulator += std::max(0.0, elapsed);
+        int steps = 0;
+        while (_accumulator >= _step && steps < _max_catch_up) {
+            _accumulator -= _step;
+            ++steps;
+        }
+        if (_accumulator >= _step) {
+            std::uint64_t dropped =
+                static_cast<std::uint64_t>(_accumulator / _step);
+            _dropped_steps += dropped;
+            _accumulator -= dropped * _step;
+        }
+        return steps;
+    }
+
+    // Time not simulated yet, in [0 ; step[
+    inline double accumulator() const { return _accumulator; }
+    // Fraction of a step in the accumulator, in [0 ; 1[
+    inline double alpha() const { return _accumulator / _step; }
+    // Seconds until the next step is due
+    inline double time_to_next_step() const { return _step - _accumulator; }
+    inline double step() const { return _step; }
+    inline int max_catch_up() const { return _max_catch_up; }
+    // Steps skipped because the loop was too far behind
+    inline std::uint64_t dropped_steps() const { return _dropped_steps; }
+
+ protected:
+    double _step;
+    int _max_catch_up;
+    double _accumulator{0};
+    std::uint64_t _dropped_steps{0};
+};
+
+#endif  // WORLD_FIXED_TIMESTEP_H_
@@ -18,10 +18,16 @@
 #define KD_TOT_DIM 2
 #define KD_DIM_1 0
 #define KD_DIM_2 1
+// Bound on the depth of a bulk-built tree, indices being 32 bits wide
+#define KD_MAX_DEPTH 64
 
 #include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <memory>
 #include <vector>
+#include "world/vision_cone.h"
 
 // A 2 dimensional templated k-d tree
 template <typename T>  // T has a pos method that returns a Vector
@@ -31,10 +37,33 @@ class KDTree {
     KDTree() = default;
     ~KDTree() { delete _root; }
 
+    // Insert one entity in the pointer-based tree. This drops any bulk-built
+    // tree
     inline void insert(const std::shared_ptr<T> x) {
+        _nodes.clear();
+        _source = nullptr;
         insert(x, _root, KD_DIM_1);
     }
 
+    // Bulk-build a balanced tree from count entities starting at first,
+    // splitting on the median of each range. The nodes live in one contiguous
+    // array that is kept between builds, so a steady-state rebuild does not
+    // allocate. The source array must outlive the queries on the tree.
+    void build(const std::shared_ptr<T>* first, std::size_t count);
+    inline void build(const std::vector<std::shared_ptr<T>>& entities) {
+        build(entities.data(), entities.size());
+    }
+
+    // Make the coordinates wrap around [0 ; width[ x [0 ; height[ for the
+    // periodic queries. A null size leaves that dimension unbounded
+    inline void set_periodic_domain(double width, double height) {
+        _period[KD_DIM_1] = width;
+        _period[KD_DIM_2] = height;
+    }
+
+    // Number of nodes in the bulk-built tree
+    inline std::size_t flat_size() const { return _nodes.size(); }
+
     inline auto root() const { return _root; }
 
     inline std::vector<std::weak_ptr<T>> norm1_range_query(const T& center,
@@ -44,15 +73,179 @@ class KDTree {
 
     inline std::vector<std::weak_ptr<T>> norm1_range_query(
         const Eigen::Vector2d& center, float radius) const {
+        if (_source != nullptr) {
+            std::vector<std::weak_ptr<T>> result;
+            norm1_range_visit(center, radius, [&](std::uint32_t index) {
+                result.push_back(_source[index]);
+            });
+            return result;
+        }
         return norm1_range_query(center, radius, _root, KD_DIM_1);
     }
 
+    // Append to result the index of each entity of the bulk-built tree that
+    // lies in the norm1 ball. Nothing is allocated if result has the capacity
+    inline void norm1_range_query(const Eigen::Vector2d& center, float radius,
+                                  std::vector<std::uint32_t>& result) const {
+        norm1_range_visit(center, radius,
+                          [&](std::uint32_t index) { result.push_back(index); });
+    }
+
+    // Call visit(index) for each entity of the bulk-built tree that lies in
+    // the norm1 ball, index being its position in the array given to build
+    template <typename F>
+    inline void norm1_range_visit(const Eigen::Vector2d& center, float radius,
+                                  F&& visit) const {
+        if (radius == 0) {
+            return;
+        }
+        float pos_rad = std::abs(radius);
+        double min[KD_TOT_DIM] = {center(0) - pos_rad, center(1) - pos_rad};
+        double max[KD_TOT_DIM] = {center(0) + pos_rad, center(1) + pos_rad};
+        auto visit_index = [&](const FlatNode& node) { visit(node.index); };
+        box_visit(min, max, visit_index);
+    }
+
+    // Call visit(index, offset) exactly once for each entity of the bulk-built
+    // tree that lies in the norm1 ball on the periodic domain, offset being
+    // the minimum image vector going from center to the entity
+    template <typename F>
+    void periodic_range_visit(const Eigen::Vector2d& center, float radius,
+                              F&& visit) const {
+        if (radius == 0) {
+            return;
+        }
+        PeriodicBoxes boxes(center, std::abs(radius), _period);
+        auto visit_with_offset = [&](const FlatNode& node) {
+            visit(node.index, boxes.offset(node, _period));
+        };
+
+        for (int i = 0; i < boxes.count[KD_DIM_1]; ++i) {
+            for (int j = 0; j < boxes.count[KD_DIM_2]; ++j) {
+                double min[KD_TOT_DIM] = {boxes.lo[KD_DIM_1][i],
+                                          boxes.lo[KD_DIM_2][j]};
+                double max[KD_TOT_DIM] = {boxes.hi[KD_DIM_1][i],
+                                          boxes.hi[KD_DIM_2][j]};
+                box_visit(min, max, visit_with_offset);
+            }
+        }
+    }
+
+    // Call visit(index, offset) exactly once for each entity of the bulk-built
+    // tree that cone.contains on the periodic domain, offset being the
+    // minimum image vector going from the apex to the entity. The subtrees
+    // whose region misses the cone are not walked
+    template <typename F>
+    void periodic_cone_visit(const VisionCone& cone, F&& visit) const {
+        if (cone.radius <= 0) {
+            return;
+        }
+        PeriodicBoxes boxes(cone.apex, cone.radius, _period);
+        auto visit_in_cone = [&](const FlatNode& node) {
+            Eigen::Vector2d offset = boxes.offset(node, _period);
+            if (cone.contains(offset)) {
+                visit(node.index, offset);
+            }
+        };
+
+        for (int i = 0; i < boxes.count[KD_DIM_1]; ++i) {
+            for (int j = 0; j < boxes.count[KD_DIM_2]; ++j) {
+                double min[KD_TOT_DIM] = {boxes.lo[KD_DIM_1][i],
+                                          boxes.lo[KD_DIM_2][j]};
+                double max[KD_TOT_DIM] = {boxes.hi[KD_DIM_1][i],
+                                          boxes.hi[KD_DIM_2][j]};
+                if (boxes.whole_period) {
+                    // The images of the apex are ambiguous, do not prune
+                    box_visit(min, max, visit_in_cone);
+                    continue;
+                }
+                double apex[KD_TOT_DIM] = {boxes.apex[KD_DIM_1][i],
+                                           boxes.apex[KD_DIM_2][j]};
+                cone_box_visit(min, max, apex, cone, visit_in_cone);
+            }
+        }
+    }
+
+    // Empty the tree. The bulk-build node array keeps its capacity
     inline void clean() {
         delete _root;
         _root = nullptr;
+        _nodes.clear();
+        _source = nullptr;
     }
 
  private:
+    // The norm1 ball around center on the periodic domain. Each dimension is
+    // covered by at most 2 disjoint intervals, so the ball is at most 4
+    // disjoint boxes in the tree
+    struct PeriodicBoxes {
+        double lo[KD_TOT_DIM][2];
+        double hi[KD_TOT_DIM][2];
+        // Image of the center seen from each interval
+        double apex[KD_TOT_DIM][2];
+        int count[KD_TOT_DIM];
+        double wrapped_center[KD_TOT_DIM];
+        // True if an interval covers a whole period
+        bool whole_period{false};
+
+        PeriodicBoxes(const Eigen::Vector2d& center, double pos_rad,
+                      const double (&period)[KD_TOT_DIM]) {
+            for (int dim = 0; dim < KD_TOT_DIM; ++dim) {
+                double c = center(dim);
+                if (period[dim] <= 0) {
+                    set(dim, c, c - pos_rad, c + pos_rad);
+                    continue;
+                }
+                c -= period[dim] * std::floor(c / period[dim]);
+                if (2 * pos_rad >= period[dim]) {
+                    set(dim, c, 0, period[dim]);
+                    whole_period = true;
+                } else if (c - pos_rad < 0) {
+                    set(dim, c, 0, c + pos_rad);
+                    add(dim, c + period[dim], c - pos_rad + period[dim],
+                        period[dim]);
+                } else if (c + pos_rad >= period[dim]) {
+                    set(dim, c, c - pos_rad, period[dim]);
+                    add(dim, c - period[dim], 0, c + pos_rad - period[dim]);
+                } else {
+                    set(dim, c, c - pos_rad, c + pos_rad);
+                }
+            }
+        }
+
+        inline void set(int dim, double c, double low, double high) {
+            wrapped_center[dim] = c;
+            count[dim] = 0;
+            add(dim, c, low, high);
+        }
+
+        inline void add(int dim, double image, double low, double high) {
+            lo[dim][count[dim]] = low;
+            hi[dim][count[dim]] = high;
+            apex[dim][count[dim]] = image;
+            ++count[dim];
+        }
+
+        // Minimum image vector going from the center to node
+        template <typename Node>
+        inline Eigen::Vector2d offset(
+            const Node& node, const double (&period)[KD_TOT_DIM]) const {
+            Eigen::Vector2d result(node.x - wrapped_center[KD_DIM_1],
+                                   node.y - wrapped_center[KD_DIM_2]);
+            for (int dim = 0; dim < KD_TOT_DIM; ++dim) {
+                if (period[dim] <= 0) {
+                    continue;
+                }
+                if (result(dim) > period[dim] / 2) {
+                    result(dim) -= period[dim];
+                } else if (result(dim) < -period[dim] / 2) {
+                    result(dim) += period[dim];
+                }
+            }
+            return result;
+        }
+    };
+
     struct KDNode {
         std::weak_ptr<T> _data{};
         KDNode* left{nullptr};
@@ -95,8 +288,142 @@ class KDTree {
         }
     }
 
+    // Node of the bulk-built tree. The subtree of the range [lo, hi) of
+    // _nodes is rooted at (lo + hi) / 2, so no child pointers are stored
+    struct FlatNode {
+        double x;
+        double y;
+        // Index of the entity in the array given to build
+        std::uint32_t index;
+        inline double coord(int dim) const { return dim == KD_DIM_1 ? x : y; }
+    };
+
+    void build(std::size_t lo, std::size_t hi, int split_direction) {
+        while (hi - lo > 1) {
+            std::size_t mid = lo + (hi - lo) / 2;
+            std::nth_element(_nodes.begin() + lo, _nodes.begin() + mid,
+                             _nodes.begin() + hi,
+                             [split_direction](const FlatNode& lhs,
+                                               const FlatNode& rhs) {
+                                 return lhs.coord(split_direction) <
+                                        rhs.coord(split_direction);
+                             });
+            int next_direction = (split_direction + 1) % KD_TOT_DIM;
+            build(lo, mid, next_direction);
+            lo = mid + 1;
+            split_direction = next_direction;
+        }
+    }
+
+    // Depth-first walk of the bulk-built tree over the box [min ; max].
+    // The pending right subtrees go on a fixed size stack : the build splits
+    // ranges in halves so the depth never exceeds the bit width of the index
+    template <typename F>
+    void box_visit(const double (&min)[KD_TOT_DIM],
+                   const double (&max)[KD_TOT_DIM], F& visit) const {
+        struct Range {
+            std::size_t lo;
+            std::size_t hi;
+            int split_direction;
+        };
+        Range stack[KD_MAX_DEPTH];
+        int stack_size = 0;
+        stack[stack_size++] = {0, _nodes.size(), KD_DIM_1};
+
+        while (stack_size > 0) {
+            Range range = stack[--stack_size];
+            while (range.lo < range.hi) {
+                std::size_t mid = range.lo + (range.hi - range.lo) / 2;
+                const FlatNode& node = _nodes[mid];
+                if (min[0] <= node.x && node.x <= max[0] && min[1] <= node.y &&
+                    node.y <= max[1]) {
+                    visit(node);
+                }
+
+                int split_direction = range.split_direction;
+                int next_direction = (split_direction + 1) % KD_TOT_DIM;
+                double split = node.coord(split_direction);
+                bool go_left = min[split_direction] <= split;
+                bool go_right = max[split_direction] >= split;
+                if (go_left && go_right) {
+                    stack[stack_size++] = {mid + 1, range.hi, next_direction};
+                    range = {range.lo, mid, next_direction};
+                } else if (go_left) {
+                    range = {range.lo, mid, next_direction};
+                } else {
+                    range = {mid + 1, range.hi, next_direction};
+                }
+            }
+        }
+    }
+
+    // Same walk as box_visit, keeping the region of each subtree so that the
+    // subtrees whose region (clipped to the box) misses the cone are
+    // skipped. apex is the position of the apex seen from the box
+    template <typename F>
+    void cone_box_visit(const double (&min)[KD_TOT_DIM],
+                        const double (&max)[KD_TOT_DIM],
+                        const double (&apex)[KD_TOT_DIM],
+                        const VisionCone& cone, F& visit) const {
+        struct Range {
+            std::size_t lo;
+            std::size_t hi;
+            int split_direction;
+            // Region of the subtree, as offsets from the apex
+            double low[KD_TOT_DIM];
+            double high[KD_TOT_DIM];
+        };
+        Range stack[KD_MAX_DEPTH];
+        int stack_size = 0;
+        Range root{0, _nodes.size(), KD_DIM_1, {}, {}};
+        for (int dim = 0; dim < KD_TOT_DIM; ++dim) {
+            root.low[dim] = min[dim] - apex[dim];
+            root.high[dim] = max[dim] - apex[dim];
+        }
+        stack[stack_size++] = root;
+
+        while (stack_size > 0) {
+            Range range = stack[--stack_size];
+            while (range.lo < range.hi &&
+                   cone.may_intersect(range.low, range.high)) {
+                std::size_t mid = range.lo + (range.hi - range.lo) / 2;
+                const FlatNode& node = _nodes[mid];
+                if (min[0] <= node.x && node.x <= max[0] && min[1] <= node.y &&
+                    node.y <= max[1]) {
+                    visit(node);
+                }
+
+                int split_direction = range.split_direction;
+                double split = node.coord(split_direction);
+                bool go_left = min[split_direction] <= split;
+                bool go_right = max[split_direction] >= split;
+                Range left = range;
+                left.hi = mid;
+                left.split_direction = (split_direction + 1) % KD_TOT_DIM;
+                left.high[split_direction] =
+                    std::min(left.high[split_direction],
+                             split - apex[split_direction]);
+                Range right = left;
+                right.lo = mid + 1;
+                right.hi = range.hi;
+                right.high[split_direction] = range.high[split_direction];
+                right.low[split_direction] =
+                    std::max(right.low[split_direction],
+                             split - apex[split_direction]);
+                if (go_left && go_right) {
+                    stack[stack_size++] = right;
+                    range = left;
+                } else if (go_left) {
+                    range = left;
+                } else {
+                    range = right;
+                }
+            }
+        }
+    }
+
     std::vector<std::weak_ptr<T>> norm1_range_query(
-        const Eigen::Vector2d& center, float radius, const KDNode*&& current,
+        const Eigen::Vector2d& center, float radius, const KDNode* current,
         int split_direction) const {
         std::vector<std::weak_ptr<T>> result;
         float pos_rad = std::abs(radius);
@@ -143,6 +470,25 @@ class KDTree {
 
  protected:
     KDNode* _root{nullptr};
+    // Size of the periodic domain in each dimension, 0 when unbounded
+    double _period[KD_TOT_DIM]{0, 0};
+    // Bulk-built tree, reused between builds
+    std::vector<FlatNode> _nodes{};
+    // Entities the bulk-built tree indexes into
+    const std::shared_ptr<T>* _source{nullptr};
 };
 
+template <typename T>
+void KDTree<T>::build(const std::shared_ptr<T>* first, std::size_t count) {
+    delete _root;
+    _root = nullptr;
+    _source = first;
+    _nodes.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto& position = first[i]->pos();
+        _nodes[i] = {position(0), position(1), static_cast<std::uint32_t>(i)};
+    }
+    build(0, count, KD_DIM_1);
+}
+
 #endif  // WORLD_KDTREE_H_
@@ -0,0 +1,104 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLD_NEIGHBOUR_TABLE_H_
+#define WORLD_NEIGHBOUR_TABLE_H_
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "entity/entity.h"
+
+// Neighbour lists of all the entities of a World, in compressed sparse row
+// layout : the neighbours of the entity in slot i are the entity slots
+// _indices[_offsets[i] ; _offsets[i] + _counts[i][.
+// The buffers keep their capacity between ticks, so refilling the table does
+// not allocate once the neighbourhoods have reached their steady size
+class NeighbourTable {
+ public:
+    NeighbourTable() = default;
+
+    // Forget every row, the table will receive row_count rows
+    inline void reset(std::size_t row_count) {
+        _offsets.clear();
+        _counts.clear();
+        _indices.clear();
+        _offsets.reserve(row_count);
+        _counts.reserve(row_count);
+    }
+
+    // Open the row of the next slot
+    inline void begin_row() {
+        _offsets.push_back(static_cast<std::uint32_t>(_indices.size()));
+        _counts.push_back(0);
+    }
+    // Add a neighbour to the row opened last
+    inline void push(std::uint32_t neighbour_slot) {
+        _indices.push_back(neighbour_slot);
+        ++_counts.back();
+    }
+
+    // Give the table row_count rows holding index_count neighbours in
+    // total, to be filled by copy_rows
+    inline void resize(std::size_t row_count, std::size_t index_count) {
+        _offsets.resize(row_count);
+        _counts.resize(row_count);
+        _indices.resize(index_count);
+    }
+    // Copy every row of part, its first row becoming row first_row and its
+    // first neighbour landing at first_index. Copies of parts that do not
+    // overlap may run concurrently
+    inline void copy_rows(const NeighbourTable &part, std::size_t first_row,
+                          std::size_t first_index) {
+        for (std::size_t row = 0; row < part.rows(); ++row) {
+            _offsets[first_row + row] =
+                static_cast<std::uint32_t>(part._offsets[row] + first_index);
+        }
+        std::copy(part._counts.begin(), part._counts.end(),
+                  _counts.begin() + first_row);
+        std::copy(part._indices.begin(), part._indices.end(),
+                  _indices.begin() + first_index);
+    }
+
+    // Neighbour slots of the row of slot, and their count
+    inline const std::uint32_t *row(std::uint32_t slot) const {
+        return _indices.data() + _offsets[slot];
+    }
+    inline std::uint32_t row_size(std::uint32_t slot) const {
+        return _counts[slot];
+    }
+
+    // Number of rows in the table
+    inline std::size_t rows() const { return _offsets.size(); }
+    // Number of neighbour indices stored
+    inline std::size_t total() const { return _indices.size(); }
+
+    // View over the row of slot, resolving indices in entities
+    inline NeighbourView view(std::uint32_t slot,
+                              const std::shared_ptr<Entity> *entities) {
+        if (slot >= _offsets.size()) {
+            return NeighbourView();
+        }
+        return NeighbourView(entities, _indices.data() + _offsets[slot],
+                             &_counts[slot]);
+    }
+
+ protected:
+    std::vector<std::uint32_t> _offsets{};
+    std::vector<std::uint32_t> _counts{};
+    std::vector<std::uint32_t> _indices{};
+};
+
+#endif  // WORLD_NEIGHBOUR_TABLE_H_
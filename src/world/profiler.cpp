@@ -0,0 +1,110 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include "profiler.h"
+
+Profiler::Profiler(std::vector<std::string> phase_names, std::size_t window)
+    : _window(std::max<std::size_t>(1, window)) {
+    _phases.resize(phase_names.size());
+    for (std::size_t i = 0; i < phase_names.size(); ++i) {
+        _phases[i].name = std::move(phase_names[i]);
+        _phases[i].samples.assign(_window, 0);
+    }
+}
+
+Profiler::Stats Profiler::stats(int phase) const {
+    const Phase &p = _phases[phase];
+    Stats result;
+    result.count = p.count;
+    result.last = last(phase);
+    std::size_t filled = static_cast<std::size_t>(
+        std::min<std::uint64_t>(p.count, p.samples.size()));
+    if (filled == 0) {
+        return result;
+    }
+
+    std::vector<double> window(p.samples.begin(), p.samples.begin() + filled);
+    double sum = 0;
+    for (auto &&sample : window) {
+        sum += sample;
+    }
+    result.mean = sum / filled;
+    // Nearest rank percentiles
+    auto rank = [&](double q) {
+        std::size_t index = static_cast<std::size_t>(std::ceil(q * filled));
+        return index == 0 ? 0 : index - 1;
+    };
+    auto p50 = window.begin() + rank(0.5);
+    std::nth_element(window.begin(), p50, window.end());
+    result.p50 = *p50;
+    auto p99 = window.begin() + rank(0.99);
+    std::nth_element(p50, p99, window.end());
+    result.p99 = *p99;
+    result.max = *std::max_element(p99, window.end());
+    return result;
+}
+
+void Profiler::reset() {
+    for (auto &&p : _phases) {
+        std::fill(p.samples.begin(), p.samples.end(), 0);
+        p.next = 0;
+        p.count = 0;
+        p.total = 0;
+    }
+}
+
+void Profiler::write_csv(std::ostream &out) const {
+    out << "phase,count,total_s,last_s,mean_s,p50_s,p99_s,max_s\n";
+    for (std::size_t i = 0; i < _phases.size(); ++i) {
+        Stats s = stats(i);
+        out << _phases[i].name << "," << s.count << "," << _phases[i].total
+            << "," << s.last << "," << s.mean << "," << s.p50 << "," << s.p99
+            << "," << s.max << "\n";
+    }
+}
+
+void Profiler::write_json(std::ostream &out) const {
+    out << "{\n";
+    out << "   \"window\" : " << _window << ",\n";
+    out << "   \"phases\" : {";
+    for (std::size_t i = 0; i < _phases.size(); ++i) {
+        Stats s = stats(i);
+        out << (i == 0 ? "\n" : ",\n");
+        out << "      \"" << _phases[i].name << "\" : { \"count\" : " << s.count
+            << ", \"total_s\" : " << _phases[i].total
+            << ", \"last_s\" : " << s.last << ", \"mean_s\" : " << s.mean
+            << ", \"p50_s\" : " << s.p50 << ", \"p99_s\" : " << s.p99
+            << ", \"max_s\" : " << s.max << " }";
+    }
+    out << "\n   }\n}\n";
+}
+
+bool Profiler::dump(const std::string &path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+    std::string json_ext = ".json";
+    if (path.size() >= json_ext.size() &&
+        path.compare(path.size() - json_ext.size(), json_ext.size(),
+                     json_ext) == 0) {
+        write_json(out);
+    } else {
+        write_csv(out);
+    }
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,99 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLD_PROFILER_H_
+#define WORLD_PROFILER_H_
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define PROFILER_DEFAULT_WINDOW 1024
+
+// Durations of the phases of a loop, over a rolling window of the last
+// ticks. Recording a sample is a store in a ring buffer, the percentiles
+// are only computed when asked for, so it can stay on in production runs
+class Profiler {
+ public:
+    // Summary of the samples of one phase in the window, in seconds
+    struct Stats {
+        std::uint64_t count{0};
+        double last{0};
+        double mean{0};
+        double p50{0};
+        double p99{0};
+        double max{0};
+    };
+
+    Profiler() = default;
+    explicit Profiler(std::vector<std::string> phase_names,
+                      std::size_t window = PROFILER_DEFAULT_WINDOW);
+
+    // Add a duration in seconds to the window of phase
+    inline void record(int phase, double seconds) {
+        Phase &p = _phases[phase];
+        p.samples[p.next] = seconds;
+        p.next = p.next + 1 == p.samples.size() ? 0 : p.next + 1;
+        ++p.count;
+        p.total += seconds;
+    }
+
+    inline std::size_t phase_count() const { return _phases.size(); }
+    inline const std::string &phase_name(int phase) const {
+        return _phases[phase].name;
+    }
+    // Number of samples the window keeps per phase
+    inline std::size_t window() const { return _window; }
+    // Last duration recorded for phase, in seconds
+    inline double last(int phase) const {
+        const Phase &p = _phases[phase];
+        if (p.count == 0) {
+            return 0;
+        }
+        return p.samples[p.next == 0 ? p.samples.size() - 1 : p.next - 1];
+    }
+    // Number of samples recorded since the start (or the last reset)
+    inline std::uint64_t count(int phase) const { return _phases[phase].count; }
+    // Sum of the durations recorded since the start, in seconds
+    inline double total(int phase) const { return _phases[phase].total; }
+
+    // Percentiles and max of the window of phase
+    Stats stats(int phase) const;
+    // Forget every sample
+    void reset();
+
+    // One line per phase : phase,count,total_s,last_s,mean_s,p50_s,p99_s,max_s
+    void write_csv(std::ostream &out) const;
+    // One object per phase, keyed by phase name
+    void write_json(std::ostream &out) const;
+    // Write the profile to path, as JSON if path ends with .json and as CSV
+    // otherwise. Return false if the file cannot be written
+    bool dump(const std::string &path) const;
+
+ protected:
+    struct Phase {
+        std::string name{};
+        // Ring buffer of the last durations
+        std::vector<double> samples{};
+        // Slot of the next sample in the ring buffer
+        std::size_t next{0};
+        std::uint64_t count{0};
+        double total{0};
+    };
+
+    std::size_t _window{PROFILER_DEFAULT_WINDOW};
+    std::vector<Phase> _phases{};
+};
+
+#endif  // WORLD_PROFILER_H_
@@ -0,0 +1,59 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLD_RANDOM_STREAM_H_
+#define WORLD_RANDOM_STREAM_H_
+#include <cstdint>
+
+#define RANDOM_STREAM_GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL
+
+// Counter-based random stream (SplitMix64). The n-th draw is a pure function
+// of the key and n : streams are cheap to create, need no shared state, and
+// give the same numbers whatever the order or the thread they are used in
+class RandomStream {
+ public:
+    // Stream number stream of the generator seeded with seed
+    RandomStream(std::uint64_t seed, std::uint64_t stream)
+        : _key(mix(mix(seed) ^ (stream * RANDOM_STREAM_GOLDEN_GAMMA))) {}
+
+    // Draw number counter of the stream, without advancing it
+    inline std::uint64_t at(std::uint64_t counter) const {
+        return mix(_key + (counter + 1) * RANDOM_STREAM_GOLDEN_GAMMA);
+    }
+    inline std::uint64_t next() { return at(_counter++); }
+
+    // Uniform double in [0 ; 1[, from the 53 high bits of a draw
+    inline double uniform() {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+    // Uniform double in [low ; high[
+    inline double uniform(double low, double high) {
+        return low + (high - low) * uniform();
+    }
+
+    inline std::uint64_t counter() const { return _counter; }
+
+    // SplitMix64 finalizer, a bijection on 64 bits with good avalanche
+    static inline std::uint64_t mix(std::uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+ protected:
+    std::uint64_t _key;
+    std::uint64_t _counter{0};
+};
+
+#endif  // WORLD_RANDOM_STREAM_H_
@@ -0,0 +1,101 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLD_RENDER_TARGET_H_
+#define WORLD_RENDER_TARGET_H_
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Immutable picture of the entities of a World after an update, in world
+// units. World publishes them so another thread can draw while the
+// simulation goes on. Each item also has its position one update before,
+// so the renderer can interpolate between the last two states
+struct RenderFrame {
+    struct Item {
+        float x;
+        float y;
+        float previous_x;
+        float previous_y;
+        float width;
+        float height;
+        int color[4];
+    };
+
+    // Number of the update that produced the frame
+    std::uint64_t tick{0};
+    // Simulated time of the frame
+    double time{0};
+    // Time step of the simulation
+    float time_step{0};
+    // Wall-clock time (seconds of a steady clock) at which the state of the
+    // frame was due. The previous state is drawn then, and the frame state
+    // one time step later
+    double due{0};
+    // Size of the world
+    int world_width{0};
+    int world_height{0};
+    std::vector<Item> items{};
+
+    // Interpolation factor between the previous state (0) and the frame
+    // state (1) at wall-clock time now
+    inline float alpha(double now) const {
+        if (!(time_step > 0)) {
+            return 1;
+        }
+        return std::min(1.0, std::max(0.0, (now - due) / time_step));
+    }
+
+    // Position between previous and current at alpha, taking the shortest
+    // way on a periodic axis of length period and wrapping the result
+    static inline float interpolate(float previous, float current,
+                                    float alpha, float period) {
+        float delta = current - previous;
+        if (delta > period / 2) {
+            delta -= period;
+        } else if (delta < -period / 2) {
+            delta += period;
+        }
+        float result = previous + alpha * delta;
+        if (result < 0) {
+            result += period;
+        } else if (result >= period) {
+            result -= period;
+        }
+        return result;
+    }
+};
+
+// Anything World can draw its entities on. World only knows this interface,
+// so the simulation builds and runs without any windowing library
+class RenderTarget {
+ public:
+    virtual ~RenderTarget() = default;
+
+    // Add a FillRect of given color to the renderer for the next frame
+    virtual void add_FillRect_to_renderer(int w0, int h0, int w_total,
+                                          int h_total, int color[4]) = 0;
+
+    // Batched FillRects : the rects added between begin_batch and end_batch
+    // may be grouped by color and are only guaranteed to be drawn by
+    // end_batch. By default each rect is drawn at once
+    virtual void begin_batch() {}
+    virtual void add_FillRect_to_batch(int w0, int h0, int w_total,
+                                       int h_total, int color[4]) {
+        add_FillRect_to_renderer(w0, h0, w_total, h_total, color);
+    }
+    virtual void end_batch() {}
+};
+
+#endif  // WORLD_RENDER_TARGET_H_
@@ -0,0 +1,420 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include "entity/ant/ant.h"
+#include "entity/food/food.h"
+#include "log/log.h"
+#include "world.h"
+
+static_assert(sizeof(SnapshotHeader) == 144, "SnapshotHeader is padded");
+static_assert(sizeof(SnapshotParams) == 112, "SnapshotParams is padded");
+static_assert(sizeof(SnapshotEntity) == 80, "SnapshotEntity is padded");
+static_assert(sizeof(SnapshotEvent) == 80, "SnapshotEvent is padded");
+
+namespace {
+// Round offset up to the next multiple of 8
+inline std::uint64_t align8(std::uint64_t offset) {
+    return (offset + 7) & ~static_cast<std::uint64_t>(7);
+}
+
+// True if count records of record_size bytes fit in the file at offset
+inline bool fits(std::uint64_t offset, std::uint64_t count,
+                 std::uint64_t record_size, std::uint64_t file_size) {
+    return offset % 8 == 0 && offset <= file_size &&
+           count <= (file_size - offset) / record_size;
+}
+}  // namespace
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const std::string &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    void *data = mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                      PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping holds its own reference to the file
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    _data = static_cast<const char *>(data);
+    _size = static_cast<std::size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (_data != nullptr) {
+        munmap(const_cast<char *>(_data), _size);
+        _data = nullptr;
+        _size = 0;
+    }
+}
+
+bool World::save_snapshot(const std::string &path) {
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.header_size = sizeof(SnapshotHeader);
+    header.params_size = sizeof(SnapshotParams);
+    header.entity_size = sizeof(SnapshotEntity);
+    header.event_size = sizeof(SnapshotEvent);
+    header.time = _time;
+    header.time_step = _time_step;
+    header.width = _width;
+    header.height = _height;
+    for (const auto &count : _entity_count) {
+        if (count.first >= 0 && count.first < SNAPSHOT_TYPE_COUNT) {
+            header.next_id[count.first] = count.second;
+        }
+    }
+    header.seed = _seed;
+
+    // Entities mostly share a few parameter blocks : store each block once
+    std::vector<SnapshotParams> params;
+    std::map<std::string, std::uint32_t> params_index;
+    std::vector<SnapshotEntity> entities(_entity_list.size());
+    for (std::size_t i = 0; i < _entity_list.size(); ++i) {
+        const Entity &entity = *_entity_list[i];
+        SnapshotParams block;
+        std::memset(&block, 0, sizeof(block));
+        block.type = entity._type;
+        block.size[0] = entity._params.size(0);
+        block.size[1] = entity._params.size(1);
+        block.mass = entity._params.mass;
+        block.max_acceleration = entity._params.max_acceleration;
+        block.friction_factor = entity._params.friction_factor;
+        block.vision_distance = entity._params.vision_distance;
+        if (entity._type == Entity::Type::ANT) {
+            const Ant &ant = static_cast<const Ant &>(entity);
+            const Ant::AntParams &ant_params = ant.ant_params();
+            block.vision_angle_degrees = ant_params.vision_angle_degrees;
+            block.cruise_speed = ant_params.cruise_speed;
+            block.separation_potential_exp =
+                ant_params.separation_potential_exp;
+            block.cohesion_weight = ant_params.cohesion_weight;
+            block.alignment_weight = ant_params.alignment_weight;
+            block.separation_weight = ant_params.separation_weight;
+            std::copy(ant.default_color, ant.default_color + 4,
+                      block.default_color);
+            std::copy(ant.blind_color, ant.blind_color + 4,
+                      block.blind_color);
+            std::copy(ant.capped_force_color, ant.capped_force_color + 4,
+                      block.capped_force_color);
+        }
+
+        std::uint32_t index;
+        if (!params.empty() &&
+            std::memcmp(&params.back(), &block, sizeof(block)) == 0) {
+            index = params.size() - 1;
+        } else {
+            auto inserted = params_index.emplace(
+                std::string(reinterpret_cast<const char *>(&block),
+                            sizeof(block)),
+                params.size());
+            if (inserted.second) {
+                params.push_back(block);
+            }
+            index = inserted.first->second;
+        }
+
+        SnapshotEntity &record = entities[i];
+        std::memset(&record, 0, sizeof(record));
+        record.type = entity._type;
+        record.id = entity.ent_id;
+        record.params = index;
+        std::copy(entity._color, entity._color + 4, record.color);
+        for (int dim = 0; dim < 2; ++dim) {
+            record.position[dim] = entity.pos()(dim);
+            record.velocity[dim] = entity.vel()(dim);
+            record.acceleration[dim] = entity.acc()(dim);
+        }
+    }
+
+    // Events that the next updates will serve, with the same float cut as
+    // WorldEventsList::serve. A streamed queue is read ahead, not pulled
+    std::vector<SnapshotEvent> events;
+    std::string strings;
+    float now = static_cast<float>(_time);
+    _events.for_each_pending([&](const std::shared_ptr<WorldEvent> &event) {
+        if (event->time_stamp() < now) {
+            return;
+        }
+        SnapshotEvent record;
+        std::memset(&record, 0, sizeof(record));
+        record.time_stamp = event->time_stamp();
+        record.name_offset = strings.size();
+        if (event->is_creation()) {
+            auto creation = static_cast<const CreationEvent *>(event.get());
+            record.kind = SNAPSHOT_EVENT_CREATION;
+            record.flags =
+                (creation->has_position() ? SNAPSHOT_HAS_POSITION : 0) |
+                (creation->has_velocity() ? SNAPSHOT_HAS_VELOCITY : 0) |
+                (creation->has_acceleration() ? SNAPSHOT_HAS_ACCELERATION
+                                              : 0);
+            for (int dim = 0; dim < 2; ++dim) {
+                record.position[dim] = creation->pos()(dim);
+                record.velocity[dim] = creation->vel()(dim);
+                record.acceleration[dim] = creation->acc()(dim);
+            }
+            strings += creation->json_template_name();
+        } else if (event->is_destruction()) {
+            auto destruction =
+                static_cast<const DestructionEvent *>(event.get());
+            record.kind = SNAPSHOT_EVENT_DESTRUCTION;
+            record.id = destruction->id();
+            strings += destruction->entity_type();
+        } else {
+            return;
+        }
+        record.name_size = strings.size() - record.name_offset;
+        events.push_back(record);
+    });
+
+    header.params_count = params.size();
+    header.entity_count = entities.size();
+    header.event_count = events.size();
+    header.strings_size = strings.size();
+    header.params_offset = align8(sizeof(header));
+    header.entity_offset =
+        align8(header.params_offset + params.size() * sizeof(SnapshotParams));
+    header.event_offset = align8(header.entity_offset +
+                                 entities.size() * sizeof(SnapshotEntity));
+    header.strings_offset =
+        align8(header.event_offset + events.size() * sizeof(SnapshotEvent));
+    header.file_size = header.strings_offset + strings.size();
+
+    // Lay the whole file out in memory, then write it in one go
+    std::vector<char> buffer(header.file_size, 0);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    std::memcpy(buffer.data() + header.params_offset, params.data(),
+                params.size() * sizeof(SnapshotParams));
+    std::memcpy(buffer.data() + header.entity_offset, entities.data(),
+                entities.size() * sizeof(SnapshotEntity));
+    std::memcpy(buffer.data() + header.event_offset, events.data(),
+                events.size() * sizeof(SnapshotEvent));
+    std::memcpy(buffer.data() + header.strings_offset, strings.data(),
+                strings.size());
+
+    // A reader never sees a partial snapshot at path : the data reaches the
+    // disk before the rename replaces the previous snapshot
+    std::string temporary_path = path + ".tmp";
+    int fd = ::open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                    0644);
+    bool written = fd >= 0;
+    std::size_t done = 0;
+    while (written && done < buffer.size()) {
+        ssize_t count = ::write(fd, buffer.data() + done, buffer.size() - done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        written = count > 0;
+        done += written ? count : 0;
+    }
+    written = written && ::fsync(fd) == 0;
+    if (fd >= 0 && ::close(fd) != 0) {
+        written = false;
+    }
+    if (!written) {
+        LOG_ERROR("World::save_snapshot : Cannot write " << temporary_path);
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("World::save_snapshot : Cannot rename " << temporary_path
+                                                          << " to " << path);
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool World::load_snapshot(const std::string &path) {
+    MappedFile file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("World::load_snapshot : Cannot map " << path);
+        return false;
+    }
+    auto reject = [&](const char *reason) {
+        LOG_ERROR("World::load_snapshot : " << path << " " << reason);
+        return false;
+    };
+
+    // Check everything before touching the world
+    if (file.size() < sizeof(SnapshotHeader)) {
+        return reject("is too small");
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        return reject("is not a snapshot");
+    }
+    if (header.byte_order != SNAPSHOT_BYTE_ORDER) {
+        return reject("has another byte order");
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        return reject("has an unsupported version");
+    }
+    if (header.header_size != sizeof(SnapshotHeader) ||
+        header.params_size != sizeof(SnapshotParams) ||
+        header.entity_size != sizeof(SnapshotEntity) ||
+        header.event_size != sizeof(SnapshotEvent)) {
+        return reject("has unexpected record sizes");
+    }
+    if (header.width <= 0 || header.height <= 0 || !(header.time_step > 0)) {
+        return reject("has an invalid world size or time step");
+    }
+    std::uint64_t size = file.size();
+    if (header.file_size != size ||
+        !fits(header.params_offset, header.params_count,
+              sizeof(SnapshotParams), size) ||
+        !fits(header.entity_offset, header.entity_count,
+              sizeof(SnapshotEntity), size) ||
+        !fits(header.event_offset, header.event_count, sizeof(SnapshotEvent),
+              size) ||
+        !fits(header.strings_offset, header.strings_size, 1, size)) {
+        return reject("is truncated or corrupted");
+    }
+
+    // The mapping is page aligned and every array is 8-byte aligned, the
+    // records are used in place
+    const SnapshotParams *params = reinterpret_cast<const SnapshotParams *>(
+        file.data() + header.params_offset);
+    const SnapshotEntity *entities = reinterpret_cast<const SnapshotEntity *>(
+        file.data() + header.entity_offset);
+    const SnapshotEvent *events = reinterpret_cast<const SnapshotEvent *>(
+        file.data() + header.event_offset);
+    const char *strings = file.data() + header.strings_offset;
+
+    for (std::uint64_t i = 0; i < header.entity_count; ++i) {
+        if (entities[i].params >= header.params_count ||
+            params[entities[i].params].type != entities[i].type ||
+            (entities[i].type != Entity::Type::ANT &&
+             entities[i].type != Entity::Type::FOOD)) {
+            return reject("has an invalid entity");
+        }
+    }
+    for (std::uint64_t i = 0; i < header.event_count; ++i) {
+        if (events[i].name_offset > header.strings_size ||
+            events[i].name_size > header.strings_size - events[i].name_offset) {
+            return reject("has an invalid event");
+        }
+    }
+
+    std::vector<EntityTemplate> templates(header.params_count);
+    for (std::uint64_t i = 0; i < header.params_count; ++i) {
+        const SnapshotParams &block = params[i];
+        EntityTemplate &entity_template = templates[i];
+        entity_template.type = static_cast<Entity::Type>(block.type);
+        entity_template.params.size << block.size[0], block.size[1];
+        entity_template.params.mass = block.mass;
+        entity_template.params.max_acceleration = block.max_acceleration;
+        entity_template.params.friction_factor = block.friction_factor;
+        entity_template.params.vision_distance = block.vision_distance;
+        entity_template.ant.vision_angle_degrees = block.vision_angle_degrees;
+        entity_template.ant.cruise_speed = block.cruise_speed;
+        entity_template.ant.separation_potential_exp =
+            block.separation_potential_exp;
+        entity_template.ant.cohesion_weight = block.cohesion_weight;
+        entity_template.ant.alignment_weight = block.alignment_weight;
+        entity_template.ant.separation_weight = block.separation_weight;
+        std::copy(block.default_color, block.default_color + 4,
+                  entity_template.default_color);
+        std::copy(block.blind_color, block.blind_color + 4,
+                  entity_template.blind_color);
+        std::copy(block.capped_force_color, block.capped_force_color + 4,
+                  entity_template.capped_force_color);
+    }
+
+    // Drop the current state, as the destructor does
+    clear_entities();
+    _events.clear();
+    _entity_count.clear();
+
+    _time = header.time;
+    _time_step = header.time_step;
+    _width = header.width;
+    _height = header.height;
+    _seed = header.seed;
+    for (int type = 0; type < SNAPSHOT_TYPE_COUNT; ++type) {
+        if (header.next_id[type] > 0) {
+            _entity_count[static_cast<Entity::Type>(type)] =
+                header.next_id[type];
+        }
+    }
+
+    _entity_list.reserve(header.entity_count);
+    for (std::uint64_t i = 0; i < header.entity_count; ++i) {
+        const SnapshotEntity &record = entities[i];
+        const EntityTemplate &entity_template = templates[record.params];
+        auto p_newEnt =
+            Entity::makeEntity(_pools, _store, entity_template.type,
+                               record.id, *this, entity_template, 0.0f, 0.0f);
+        std::weak_ptr<Entity> weak = adopt_entity(std::move(p_newEnt));
+        Entity &entity = *weak.lock();
+        // The constructors may have changed some parameters (food mass)
+        entity._params = entity_template.params;
+        entity.update_drag();
+        entity.set_color(record.color[0], record.color[1], record.color[2],
+                         record.color[3]);
+        entity.mut_pos() << record.position[0], record.position[1];
+        entity.mut_vel() << record.velocity[0], record.velocity[1];
+        entity.mut_acc() << record.acceleration[0], record.acceleration[1];
+    }
+
+    for (std::uint64_t i = 0; i < header.event_count; ++i) {
+        const SnapshotEvent &record = events[i];
+        std::string name(strings + record.name_offset, record.name_size);
+        if (record.kind == SNAPSHOT_EVENT_CREATION) {
+            auto creation =
+                std::make_shared<CreationEvent>(record.time_stamp, name);
+            if (record.flags & SNAPSHOT_HAS_POSITION) {
+                creation->set_pos(Eigen::Vector2d(record.position[0],
+                                                  record.position[1]));
+            }
+            if (record.flags & SNAPSHOT_HAS_VELOCITY) {
+                creation->set_vel(Eigen::Vector2d(record.velocity[0],
+                                                  record.velocity[1]));
+            }
+            if (record.flags & SNAPSHOT_HAS_ACCELERATION) {
+                creation->set_acc(Eigen::Vector2d(record.acceleration[0],
+                                                  record.acceleration[1]));
+            }
+            _events.append(std::move(creation));
+        } else if (record.kind == SNAPSHOT_EVENT_DESTRUCTION) {
+            _events.append(std::make_shared<DestructionEvent>(
+                record.time_stamp, name, record.id));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,145 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLD_SNAPSHOT_H_
+#define WORLD_SNAPSHOT_H_
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Binary snapshot of a World, see World::save_snapshot.
+// The file is a header followed by arrays of fixed-size records, each at an
+// 8-byte aligned offset, so a memory-mapped file is read in place :
+//   SnapshotHeader
+//   SnapshotParams[params_count]   distinct parameter blocks
+//   SnapshotEntity[entity_count]   in entity list order
+//   SnapshotEvent[event_count]     pending events
+//   char[strings_size]             names used by the events
+// Numbers are in the byte order of the machine that wrote the file, a
+// loader with another byte order rejects it
+#define SNAPSHOT_MAGIC "FLOCKSNP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+// Number of Entity::Type values, the next id of each type is saved
+#define SNAPSHOT_TYPE_COUNT 3
+
+#define SNAPSHOT_EVENT_CREATION 1
+#define SNAPSHOT_EVENT_DESTRUCTION 2
+#define SNAPSHOT_HAS_POSITION 0x1
+#define SNAPSHOT_HAS_VELOCITY 0x2
+#define SNAPSHOT_HAS_ACCELERATION 0x4
+
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    // Sizes of the records, checked on load
+    std::uint32_t header_size;
+    std::uint32_t params_size;
+    std::uint32_t entity_size;
+    std::uint32_t event_size;
+
+    double time;
+    float time_step;
+    std::int32_t width;
+    std::int32_t height;
+    std::int32_t next_id[SNAPSHOT_TYPE_COUNT];
+    std::uint64_t seed;
+
+    std::uint64_t params_count;
+    std::uint64_t entity_count;
+    std::uint64_t event_count;
+    std::uint64_t strings_size;
+    // Offsets of the arrays from the start of the file
+    std::uint64_t params_offset;
+    std::uint64_t entity_offset;
+    std::uint64_t event_offset;
+    std::uint64_t strings_offset;
+    // Size of the whole file
+    std::uint64_t file_size;
+};
+
+// Parameters of an entity (Entity::Params, and Ant::AntParams with the
+// colors for ants), shared by all the entities that have the same ones
+struct SnapshotParams {
+    std::int32_t type;
+    std::int32_t reserved;
+    double size[2];
+    float mass;
+    float max_acceleration;
+    float friction_factor;
+    float vision_distance;
+    float vision_angle_degrees;
+    float cruise_speed;
+    float separation_potential_exp;
+    float cohesion_weight;
+    float alignment_weight;
+    float separation_weight;
+    std::int32_t default_color[4];
+    std::int32_t blind_color[4];
+    std::int32_t capped_force_color[4];
+};
+
+struct SnapshotEntity {
+    std::int32_t type;
+    std::int32_t id;
+    // Index of the parameter block of the entity
+    std::uint32_t params;
+    std::int32_t color[4];
+    std::int32_t reserved;
+    double position[2];
+    double velocity[2];
+    double acceleration[2];
+};
+
+struct SnapshotEvent {
+    float time_stamp;
+    // SNAPSHOT_EVENT_CREATION or SNAPSHOT_EVENT_DESTRUCTION
+    std::uint32_t kind;
+    // SNAPSHOT_HAS_* flags of a creation
+    std::uint32_t flags;
+    // Id of the entity to destroy
+    std::int32_t id;
+    // Template name of a creation, or entity type of a destruction, as a
+    // range of the strings array
+    std::uint64_t name_offset;
+    std::uint64_t name_size;
+    double position[2];
+    double velocity[2];
+    double acceleration[2];
+};
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+ public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path) { open(path); }
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Map path, unmapping the previous file. Return false on failure
+    bool open(const std::string &path);
+    void close();
+
+    inline bool is_open() const { return _data != nullptr; }
+    inline const char *data() const { return _data; }
+    inline std::size_t size() const { return _size; }
+
+ protected:
+    const char *_data{nullptr};
+    std::size_t _size{0};
+};
+
+#endif  // WORLD_SNAPSHOT_H_
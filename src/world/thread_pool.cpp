@@ -0,0 +1,90 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(unsigned thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    _workers.reserve(thread_count - 1);
+    for (unsigned i = 1; i < thread_count; ++i) {
+        _workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto &&worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(std::size_t task_count,
+                     const std::function<void(std::size_t)> &task) {
+    if (_workers.empty() || task_count <= 1) {
+        for (std::size_t i = 0; i < task_count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task = &task;
+        _task_count = task_count;
+        _next_task = 0;
+        _busy_workers = static_cast<unsigned>(_workers.size());
+        ++_batch;
+    }
+    _wake.notify_all();
+    drain();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _busy_workers == 0; });
+    _task = nullptr;
+}
+
+void ThreadPool::work() {
+    std::uint64_t last_batch = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _stop || _batch != last_batch; });
+            if (_stop) {
+                return;
+            }
+            last_batch = _batch;
+        }
+        drain();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (--_busy_workers == 0) {
+                _done.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::drain() {
+    std::size_t i;
+    while ((i = _next_task.fetch_add(1)) < _task_count) {
+        (*_task)(i);
+    }
+}
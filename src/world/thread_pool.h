@@ -0,0 +1,68 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLD_THREAD_POOL_H_
+#define WORLD_THREAD_POOL_H_
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads running batches of independent tasks.
+// The thread calling run takes part in the batch, so a pool of size n
+// starts n - 1 workers and a pool of size 1 runs everything inline
+class ThreadPool {
+ public:
+    // A thread_count of 0 means one thread per hardware thread
+    explicit ThreadPool(unsigned thread_count = 1);
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    // Number of threads running the tasks, the caller included
+    inline unsigned size() const {
+        return static_cast<unsigned>(_workers.size()) + 1;
+    }
+
+    // Call task(i) for each i in [0 ; task_count[ and return once every
+    // call is done. The order in which tasks run is unspecified
+    void run(std::size_t task_count,
+             const std::function<void(std::size_t)> &task);
+
+ protected:
+    std::vector<std::thread> _workers{};
+    std::mutex _mutex{};
+    // Signals the workers that a batch started (or that the pool stops)
+    std::condition_variable _wake{};
+    // Signals run that the last worker finished the batch
+    std::condition_variable _done{};
+    const std::function<void(std::size_t)> *_task{nullptr};
+    std::size_t _task_count{0};
+    std::atomic<std::size_t> _next_task{0};
+    // Workers that did not finish the current batch yet
+    unsigned _busy_workers{0};
+    // Counts the batches, so workers can tell a new one from a spurious wake
+    std::uint64_t _batch{0};
+    bool _stop{false};
+
+    // Loop of a worker thread
+    void work();
+    // Run tasks of the current batch until there are none left
+    void drain();
+};
+
+#endif  // WORLD_THREAD_POOL_H_
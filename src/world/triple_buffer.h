@@ -0,0 +1,68 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLD_TRIPLE_BUFFER_H_
+#define WORLD_TRIPLE_BUFFER_H_
+#include <atomic>
+
+// The middle slot index is stored with a flag telling whether it holds a
+// value the reader has not taken yet
+#define TRIPLE_BUFFER_INDEX 0x3u
+#define TRIPLE_BUFFER_FRESH 0x4u
+
+// Lock-free single producer / single consumer triple buffer. The writer
+// fills back() then publishes it, the reader takes the latest published
+// value with update() and reads it through front(). Neither side ever
+// waits : the writer always has a slot of its own, and values the reader
+// did not take in time are simply overwritten. Slots are reused, so values
+// holding vectors stop allocating once they reached their size
+template <typename T>
+class TripleBuffer {
+ public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    // Slot owned by the writer
+    inline T &back() { return _slots[_back]; }
+    // Make the back slot the latest value, and take another slot to write
+    inline void publish() {
+        unsigned previous = _middle.exchange(_back | TRIPLE_BUFFER_FRESH,
+                                             std::memory_order_acq_rel);
+        _back = previous & TRIPLE_BUFFER_INDEX;
+    }
+
+    // Take the latest published value, if any was published since the last
+    // call. Return true if front changed
+    inline bool update() {
+        unsigned middle = _middle.load(std::memory_order_relaxed);
+        if ((middle & TRIPLE_BUFFER_FRESH) == 0) {
+            return false;
+        }
+        unsigned previous =
+            _middle.exchange(_front, std::memory_order_acq_rel);
+        _front = previous & TRIPLE_BUFFER_INDEX;
+        return true;
+    }
+    // Slot owned by the reader
+    inline const T &front() const { return _slots[_front]; }
+
+ protected:
+    T _slots[3]{};
+    unsigned _back{0};
+    std::atomic<unsigned> _middle{1};
+    unsigned _front{2};
+};
+
+#endif  // WORLD_TRIPLE_BUFFER_H_
@@ -0,0 +1,92 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORLD_VISION_CONE_H_
+#define WORLD_VISION_CONE_H_
+
+// Relative slack on the pruning tests, so that rounding never prunes a box
+// holding an entity that contains() accepts
+#define CONE_PRUNE_SLACK 1e-9
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+
+// Circular sector seen from apex : the points closer than radius whose
+// direction makes an angle with direction below the half-angle of the cone.
+// The half-angle is only kept as its cosine, so no acos is ever taken
+struct VisionCone {
+    Eigen::Vector2d apex{0, 0};
+    // Unit vector along the axis of the cone
+    Eigen::Vector2d direction{1, 0};
+    // Cosine of the half-angle. Above 1 only the apex is seen, below -1 the
+    // cone is the whole disk
+    double cos_threshold{-2};
+    double radius{0};
+
+    // Test of Ant::is_in_vision_triangle, offset going from the apex
+    inline bool contains(const Eigen::Vector2d &offset) const {
+        double distance_squared =
+            offset(0) * offset(0) + offset(1) * offset(1);
+        return distance_squared <= radius * radius &&
+               (distance_squared == 0 ||
+                offset(0) * direction(0) + offset(1) * direction(1) >
+                    cos_threshold * std::sqrt(distance_squared));
+    }
+
+    // False only if no offset of the box [min ; max] (taken from the apex)
+    // is in the cone, so the box can be skipped
+    inline bool may_intersect(const double (&min)[2],
+                              const double (&max)[2]) const {
+        double slack = CONE_PRUNE_SLACK * std::max(1.0, radius);
+        // Closest point of the box to the apex
+        double closest_x = std::min(std::max(0.0, min[0]), max[0]);
+        double closest_y = std::min(std::max(0.0, min[1]), max[1]);
+        double reach = radius + slack;
+        if (closest_x * closest_x + closest_y * closest_y > reach * reach) {
+            return false;
+        }
+        if (cos_threshold < 0) {
+            // A cone wider than a half-plane is not convex, the disk is the
+            // only bound
+            return true;
+        }
+        if (cos_threshold >= 1) {
+            return closest_x == 0 && closest_y == 0;
+        }
+        // A cone narrower than a half-plane is the wedge between its edges :
+        // the box is out if its 4 corners are on the far side of one edge
+        double c = cos_threshold;
+        double s = std::sqrt(1 - c * c);
+        double dx = direction(0);
+        double dy = direction(1);
+        // Edges rotated clockwise and counterclockwise from the axis
+        double right_x = c * dx + s * dy;
+        double right_y = c * dy - s * dx;
+        double left_x = c * dx - s * dy;
+        double left_y = c * dy + s * dx;
+        bool right_of_cone = true;
+        bool left_of_cone = true;
+        for (double x : {min[0], max[0]}) {
+            for (double y : {min[1], max[1]}) {
+                // Cross products with the edges, positive towards the axis
+                right_of_cone &= right_x * y - right_y * x < -slack;
+                left_of_cone &= x * left_y - y * left_x < -slack;
+            }
+        }
+        return !right_of_cone && !left_of_cone;
+    }
+};
+
+#endif  // WORLD_VISION_CONE_H_
@@ -14,28 +14,72 @@
 
 // Since World will instantiate all makeEntity templates, we need fully defined
 // Entity Derived Classes
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <functional>
 #include "FlockingConfig.h"
 #include "entity/ant/ant.h"
 #include "entity/food/food.h"
 #include "jsoncpp/json/json.h"
-#include "ui/window/mainwindow.h"
+#include "log/log.h"
 #include "world.h"
 
-World::World(int w, int h, float dt) : _width(w), _height(h), _time_step(dt) {}
+World::World(int w, int h, float dt, SpatialIndex spatial_index)
+    : _width(w),
+      _height(h),
+      _time_step(dt),
+      _spatial_index(spatial_index) {}
 
-World::~World() {}
+World::~World() { clear_entities(); }
 
-void World::set_render_window(MainWindow &window) { _render_window = &window; }
+void World::clear_entities() {
+    // Entities still shared outside of the world keep their kinematic state
+    // in the detached store, the others give their slot back
+    while (!_entity_list.empty()) {
+        if (_entity_list.back().use_count() > 1) {
+            _entity_list.back()->move_to_store(EntityStore::detached());
+        }
+        _entity_list.pop_back();
+    }
+    _slot_of.clear();
+    _pending_removals.clear();
+    _neighbour_table.reset(0);
+    _verlet_candidates.reset(0);
+    _verlet_anchors.clear();
+    _verlet_stale = true;
+}
+
+void World::set_render_window(RenderTarget &window) {
+    _render_window = &window;
+}
+
+void World::detach_render_window() { _render_window = nullptr; }
+
+void World::set_frame_buffer(TripleBuffer<RenderFrame> *buffer) {
+    _frame_buffer = buffer;
+}
+
+void World::set_seed(std::uint64_t seed) { _seed = seed; }
 
 void World::set_world_size(int w, int h) {
     _width = w;
     _height = h;
 }
 
+void World::set_window_size(int width_in_px, int height_in_px) {
+    _pending_window_size.store(
+        (static_cast<std::uint64_t>(std::max(1, width_in_px)) << 32) |
+        static_cast<std::uint32_t>(std::max(1, height_in_px)));
+}
+
 void World::set_time_step(float t) { _time_step = t; }
 
-void World::wrap_around(Eigen::Vector2d &position) {
+void World::set_thread_count(unsigned thread_count) {
+    _pool.reset(new ThreadPool(thread_count));
+}
+
+void World::wrap_around(Eigen::Vector2d &position) const {
     while (position(0) >= _width || position(0) < 0) {
         if (position(0) < 0) {
             position(0) += _width;
@@ -63,7 +107,7 @@ Eigen::Vector2d World::convert(const Eigen::Vector2d &position) const {
 }
 
 Eigen::Vector2d World::point_to(const Eigen::Vector2d &tail,
-                                const Eigen::Vector2d &head) {
+                                const Eigen::Vector2d &head) const {
     if (!(head(0) >= 0 && head(1) < _width && tail(0) >= 0 &&
           tail(1) < _height)) {
         throw std::runtime_error(
@@ -86,146 +130,429 @@ Eigen::Vector2d World::point_to(const Eigen::Vector2d &tail,
     return result;
 }
 
-MainWindow &World::get_mut_window() { return *_render_window; }
+Eigen::Vector2d World::periodic_offset(const Eigen::Vector2d &tail,
+                                       const Eigen::Vector2d &head) const {
+    // Same minimum image as the periodic queries of the spatial indexes
+    Eigen::Vector2d result = head - tail;
+    double period[2] = {static_cast<double>(_width),
+                        static_cast<double>(_height)};
+    for (int dim = 0; dim < 2; ++dim) {
+        if (result(dim) > period[dim] / 2) {
+            result(dim) -= period[dim];
+        } else if (result(dim) < -period[dim] / 2) {
+            result(dim) += period[dim];
+        }
+    }
+    return result;
+}
+
+RenderTarget &World::get_mut_window() { return *_render_window; }
 
 void World::update() {
+    auto start = std::chrono::steady_clock::now();
+    // Record the time elapsed since the end of the previous phase
+    auto end_phase = [&](Phase phase) {
+        auto now = std::chrono::steady_clock::now();
+        _profiler.record(static_cast<int>(phase),
+                         std::chrono::duration<double>(now - start).count());
+        start = now;
+    };
+
+    std::uint64_t window_size = _pending_window_size.exchange(0);
+    if (window_size != 0) {
+        _width_in_px = static_cast<int>(window_size >> 32);
+        _height_in_px = static_cast<int>(window_size & 0xFFFFFFFFu);
+    }
+
     _time += _time_step;
+    ++_tick;
     find_and_serve_new_events();
+    end_phase(Phase::EVENTS);
     update_tree();
+    end_phase(Phase::TREE);
     update_entity_neighbourhoods();
+    end_phase(Phase::NEIGHBOURS);
     call_entity_decision();
-    update_entity_and_renderer();
+    end_phase(Phase::DECISION);
+    integrate_store();
+    end_phase(Phase::INTEGRATE);
+    submit_to_renderer();
+    end_phase(Phase::RENDER);
+    apply_removals();
+    end_phase(Phase::REMOVE);
 }
 
-void World::find_and_serve_new_events() {
-    auto new_events_to_serve =
-        _events.events_in_time_frame(_time - _time_step, _time);
+const char *World::phase_name(Phase phase) {
+    switch (phase) {
+        case (Phase::EVENTS):
+            return "events";
+        case (Phase::TREE):
+            return "tree";
+        case (Phase::NEIGHBOURS):
+            return "neighbours";
+        case (Phase::DECISION):
+            return "decision";
+        case (Phase::INTEGRATE):
+            return "integrate";
+        case (Phase::RENDER):
+            return "render";
+        case (Phase::REMOVE):
+            return "remove";
+        default:
+            return "";
+    }
+}
 
-    for (auto &&event : new_events_to_serve) {
-        serve_json_event(event);
+std::vector<std::string> World::phase_names() {
+    std::vector<std::string> names;
+    for (int phase = 0; phase < WORLD_PHASE_COUNT; ++phase) {
+        names.emplace_back(phase_name(static_cast<Phase>(phase)));
     }
+    return names;
+}
+
+void World::find_and_serve_new_events() {
+    _events.serve(_time - _time_step, _time,
+                  [this](const std::shared_ptr<WorldEvent> &event) {
+                      serve_json_event(event);
+                  });
+}
+
+void World::set_verlet_skin(float skin) {
+    _verlet_skin = std::max(0.0f, skin);
+    _verlet_stale = true;
 }
 
 void World::update_tree() {
-    _entity_tree.clean();
-    for (auto &&entity : _entity_list) {
-        _entity_tree.insert(entity);
+    if (_verlet_skin > 0) {
+        _verlet_stale = verlet_candidates_stale();
+        if (!_verlet_stale) {
+            return;
+        }
+    }
+
+    switch (_spatial_index) {
+        case (SpatialIndex::CELL_GRID): {
+            // Cells as wide as the longest sight keep queries on 3x3 cells
+            float max_vision = 0;
+            for (auto &&entity : _entity_list) {
+                max_vision = std::max(max_vision, entity->vision_distance());
+            }
+            _entity_grid.set_cell_size(max_vision + _verlet_skin);
+            _entity_grid.set_periodic_domain(_width, _height);
+            _entity_grid.build(_entity_list);
+            break;
+        }
+        case (SpatialIndex::KDTREE):
+        default:
+            _entity_tree.set_periodic_domain(_width, _height);
+            _entity_tree.build(_entity_list);
+            break;
     }
 }
 
 void World::update_entity_neighbourhoods() {
-    for (auto &&entity : _entity_list) {
-        entity->clear_neighbours();
-        // Base case, get all neighbours inside
-        auto ent_neighbours = _entity_tree.norm1_range_query(
-            *entity, entity->vision_distance());
-        // Add the neighbours from the edges in case of wrapping around
-        float x = entity->pos()(0);
-        float y = entity->pos()(1);
-        float radius = entity->vision_distance();
-        if (x - radius < 0) {
-            Eigen::Vector2d fictive_position(x + _width, y);
-            float fictive_radius(radius - x);
-            auto add_neighbours =
-                _entity_tree.norm1_range_query(fictive_position, fictive_radius);
-            ent_neighbours.insert(ent_neighbours.end(), add_neighbours.begin(),
-                                  add_neighbours.end());
-            if (y - radius < 0) {
-                Eigen::Vector2d fictive_position2(x + _width, y + _height);
-                float fictive_radius2(radius - y);
-                auto add_neighbours2 = _entity_tree.norm1_range_query(
-                    fictive_position2,
-                    std::max(fictive_radius, fictive_radius2));
-                ent_neighbours.insert(ent_neighbours.end(),
-                                      add_neighbours2.begin(),
-                                      add_neighbours2.end());
-            }
-            if (y + radius > _height) {
-                Eigen::Vector2d fictive_position2(x + _width, y - _height);
-                float fictive_radius2(radius - (_height - y));
-                auto add_neighbours2 = _entity_tree.norm1_range_query(
-                    fictive_position2,
-                    std::max(fictive_radius, fictive_radius2));
-                ent_neighbours.insert(ent_neighbours.end(),
-                                      add_neighbours2.begin(),
-                                      add_neighbours2.end());
-            }
+    NeighbourTable &table =
+        _verlet_skin > 0 ? _verlet_candidates : _neighbour_table;
+    if (_verlet_skin <= 0 || _verlet_stale) {
+        switch (_spatial_index) {
+            case (SpatialIndex::CELL_GRID):
+                compute_neighbourhoods(_entity_grid, table, _verlet_skin);
+                break;
+            case (SpatialIndex::KDTREE):
+            default:
+                compute_neighbourhoods(_entity_tree, table, _verlet_skin);
+                break;
         }
-        if (x + radius > _width) {
-            Eigen::Vector2d fictive_position(x - _width, y);
-            float fictive_radius(radius - (_width - x));
-            auto add_neighbours =
-                _entity_tree.norm1_range_query(fictive_position, fictive_radius);
-            ent_neighbours.insert(ent_neighbours.end(), add_neighbours.begin(),
-                                  add_neighbours.end());
-            if (y - radius < 0) {
-                Eigen::Vector2d fictive_position2(x - _width, y + _height);
-                float fictive_radius2(radius - y);
-                auto add_neighbours2 = _entity_tree.norm1_range_query(
-                    fictive_position2,
-                    std::max(fictive_radius, fictive_radius2));
-                ent_neighbours.insert(ent_neighbours.end(),
-                                      add_neighbours2.begin(),
-                                      add_neighbours2.end());
-            }
-            if (y + radius > _height) {
-                Eigen::Vector2d fictive_position2(x - _width, y - _height);
-                float fictive_radius2(radius - (_height - y));
-                auto add_neighbours2 = _entity_tree.norm1_range_query(
-                    fictive_position2,
-                    std::max(fictive_radius, fictive_radius2));
-                ent_neighbours.insert(ent_neighbours.end(),
-                                      add_neighbours2.begin(),
-                                      add_neighbours2.end());
+    }
+    if (_verlet_skin <= 0) {
+        return;
+    }
+
+    if (_verlet_stale) {
+        _verlet_anchors = _store.positions();
+        _verlet_visions.resize(_entity_list.size());
+        for (std::size_t slot = 0; slot < _entity_list.size(); ++slot) {
+            _verlet_visions[slot] = _entity_list[slot]->vision_distance();
+        }
+        _verlet_stale = false;
+        ++_verlet_rebuilds;
+    }
+    filter_verlet_candidates();
+}
+
+template <typename Index>
+void World::compute_neighbourhoods(const Index &index, NeighbourTable &table,
+                                   float margin) {
+    fill_table(table, [&](std::size_t first, std::size_t last,
+                          NeighbourTable &part) {
+        VisionCone cone;
+        for (std::size_t slot = first; slot < last; ++slot) {
+            part.begin_row();
+            auto push = [&](std::uint32_t i, const Eigen::Vector2d &) {
+                part.push(i);
+            };
+            // The index wraps around the edges, so every neighbour comes
+            // once. Verlet candidates must outlast turns, so they never
+            // narrow to the cone
+            if (margin <= 0 && _entity_list[slot]->vision_cone(cone)) {
+                index.periodic_cone_visit(cone, push);
+            } else {
+                index.periodic_range_visit(
+                    _entity_list[slot]->pos(),
+                    _entity_list[slot]->vision_distance() + margin, push);
             }
         }
-        if (y - radius < 0) {
-            Eigen::Vector2d fictive_position(x, y + _height);
-            float fictive_radius(radius - y);
-            auto add_neighbours =
-                _entity_tree.norm1_range_query(fictive_position, fictive_radius);
-            ent_neighbours.insert(ent_neighbours.end(), add_neighbours.begin(),
-                                  add_neighbours.end());
+    });
+}
+
+template <typename F>
+void World::fill_table(NeighbourTable &table, F &&fill_rows) {
+    std::size_t count = _entity_list.size();
+    std::size_t part_count = std::min<std::size_t>(_pool->size(), count);
+    if (part_count <= 1) {
+        table.reset(count);
+        fill_rows(0, count, table);
+        return;
+    }
+
+    // Each thread fills the rows of a contiguous range of slots in its own
+    // table, then the tables are copied back to back in slot order
+    _neighbour_parts.resize(part_count);
+    _pool->run(part_count, [&](std::size_t part) {
+        std::size_t first = count * part / part_count;
+        std::size_t last = count * (part + 1) / part_count;
+        _neighbour_parts[part].reset(last - first);
+        fill_rows(first, last, _neighbour_parts[part]);
+    });
+
+    std::size_t total = 0;
+    for (std::size_t part = 0; part < part_count; ++part) {
+        total += _neighbour_parts[part].total();
+    }
+    table.resize(count, total);
+    _pool->run(part_count, [&](std::size_t part) {
+        std::size_t first_index = 0;
+        for (std::size_t before = 0; before < part; ++before) {
+            first_index += _neighbour_parts[before].total();
         }
-        if (y + radius > _height) {
-            Eigen::Vector2d fictive_position(x, y - _height);
-            float fictive_radius(radius - (_height - y));
-            auto add_neighbours =
-                _entity_tree.norm1_range_query(fictive_position, fictive_radius);
-            ent_neighbours.insert(ent_neighbours.end(), add_neighbours.begin(),
-                                  add_neighbours.end());
+        table.copy_rows(_neighbour_parts[part], count * part / part_count,
+                        first_index);
+    });
+}
+
+bool World::verlet_candidates_stale() const {
+    if (_verlet_anchors.size() != _entity_list.size()) {
+        return true;
+    }
+    // Two entities that each moved less than skin / 2 cannot have come
+    // closer than the skin, so every neighbour is still a candidate
+    double max_move = _verlet_skin / 2.0;
+    const auto &positions = _store.positions();
+    for (std::size_t slot = 0; slot < _entity_list.size(); ++slot) {
+        if (_entity_list[slot]->vision_distance() != _verlet_visions[slot]) {
+            return true;
+        }
+        Eigen::Vector2d moved =
+            periodic_offset(_verlet_anchors[slot], positions[slot]);
+        if (moved.cwiseAbs().maxCoeff() > max_move) {
+            return true;
         }
-        entity->neighbours().insert(entity->neighbours().end(),
-                                           ent_neighbours.begin(),
-                                           ent_neighbours.end());
-        // Keep only unique references
-        std::sort(entity->neighbours().begin(),
-                  entity->neighbours().end());
-        entity->neighbours().erase(
-            std::unique(entity->neighbours().begin(),
-                        entity->neighbours().end()),
-            entity->neighbours().end());
     }
+    return false;
+}
+
+void World::filter_verlet_candidates() {
+    const auto &positions = _store.positions();
+    fill_table(_neighbour_table, [&](std::size_t first, std::size_t last,
+                                     NeighbourTable &part) {
+        VisionCone cone;
+        for (std::size_t slot = first; slot < last; ++slot) {
+            part.begin_row();
+            const Eigen::Vector2d &center = positions[slot];
+            double radius = std::abs(_entity_list[slot]->vision_distance());
+            // The indexes see nothing at radius 0, not even the entity
+            if (radius == 0) {
+                continue;
+            }
+            bool in_cone = _entity_list[slot]->vision_cone(cone);
+            const std::uint32_t *candidates = _verlet_candidates.row(slot);
+            std::uint32_t candidate_count = _verlet_candidates.row_size(slot);
+            for (std::uint32_t k = 0; k < candidate_count; ++k) {
+                // Same neighbourhood as the spatial index queries
+                Eigen::Vector2d offset =
+                    periodic_offset(center, positions[candidates[k]]);
+                if (in_cone ? cone.contains(offset)
+                            : std::abs(offset(0)) <= radius &&
+                                  std::abs(offset(1)) <= radius) {
+                    part.push(candidates[k]);
+                }
+            }
+        }
+    });
 }
 
 void World::call_entity_decision() {
-    for (auto &&entity : _entity_list) {
-        // Update the timestep of the Entity, necessary for computation
-        entity->decision();
-    }
+    // Decisions only write the acceleration (and neighbour list) of their own
+    // entity and read the front buffers of the store, so any split of the
+    // entity list gives the same result
+    std::size_t count = _entity_list.size();
+    std::size_t part_count = std::min<std::size_t>(_pool->size(), count);
+    _pool->run(part_count, [&](std::size_t part) {
+        std::size_t last = count * (part + 1) / part_count;
+        for (std::size_t slot = count * part / part_count; slot < last;
+             ++slot) {
+            _entity_list[slot]->decision();
+        }
+    });
 }
 
 void World::update_entity_and_renderer() {
+    integrate_store();
+    submit_to_renderer();
+}
+
+void World::submit_to_renderer() {
+    if (_render_window == nullptr) {
+        return;
+    }
+    _render_window->begin_batch();
     for (auto &&entity : _entity_list) {
-        entity->update();
         Eigen::Vector2d screen_pos = convert(entity->pos());
         Eigen::Vector2d screen_size = convert(entity->size());
-        if (_render_window != nullptr) {
-            _render_window->add_FillRect_to_renderer(
-                screen_pos(0), screen_pos(1), screen_size(0), screen_size(0),
-                entity->color());
+        _render_window->add_FillRect_to_batch(
+            screen_pos(0), screen_pos(1), screen_size(0), screen_size(0),
+            entity->color());
+    }
+    _render_window->end_batch();
+}
+
+void World::publish_frame(double due) {
+    if (_frame_buffer == nullptr) {
+        return;
+    }
+    RenderFrame &frame = _frame_buffer->back();
+    frame.tick = _tick;
+    frame.time = _time;
+    frame.time_step = _time_step;
+    frame.due = due;
+    frame.world_width = _width;
+    frame.world_height = _height;
+    frame.items.resize(_entity_list.size());
+    // Slots of the store are aligned with the entity list. Entities added
+    // since the last integration have no previous state yet
+    const auto &previous = _previous_state_valid ? _store.previous_positions()
+                                                 : _store.positions();
+    for (std::size_t i = 0; i < _entity_list.size(); ++i) {
+        const Entity &entity = *_entity_list[i];
+        RenderFrame::Item &item = frame.items[i];
+        item.x = entity.pos()(0);
+        item.y = entity.pos()(1);
+        item.previous_x = previous[i](0);
+        item.previous_y = previous[i](1);
+        item.width = entity._params.size(0);
+        item.height = entity._params.size(1);
+        std::copy(entity._color, entity._color + 4, item.color);
+    }
+    _frame_buffer->publish();
+}
+
+void World::integrate_store() {
+    // Same scheme as Entity::update, reading the front buffers of the store
+    // and writing its back buffers
+    const auto &positions = _store.positions();
+    const auto &velocities = _store.velocities();
+    const auto &drags = _store.drags();
+    auto &accelerations = _store.accelerations();
+    auto &next_positions = _store.next_positions();
+    auto &next_velocities = _store.next_velocities();
+    std::size_t count = _entity_list.size();
+    std::size_t part_count = std::min<std::size_t>(_pool->size(), count);
+    _pool->run(part_count, [&](std::size_t part) {
+        std::size_t last = count * (part + 1) / part_count;
+        for (std::size_t i = count * part / part_count; i < last; ++i) {
+            accelerations[i] += Entity::friction_acceleration(
+                velocities[i], drags[i], _time_step);
+            next_velocities[i] = velocities[i] + _time_step * accelerations[i];
+            next_positions[i] = positions[i] + _time_step * next_velocities[i];
+            wrap_around(next_positions[i]);
+            accelerations[i] << 0, 0;
         }
+    });
+    _store.swap_buffers();
+    _previous_state_valid = true;
+}
+
+void World::apply_removals() {
+    if (_pending_removals.empty()) {
+        return;
     }
+    // Highest slots first : the last entity of the list is then never one
+    // that is still to be removed
+    std::sort(_pending_removals.begin(), _pending_removals.end(),
+              std::greater<std::uint32_t>());
+    _pending_removals.erase(
+        std::unique(_pending_removals.begin(), _pending_removals.end()),
+        _pending_removals.end());
+
+    for (std::uint32_t slot : _pending_removals) {
+        std::shared_ptr<Entity> removed = std::move(_entity_list[slot]);
+        _slot_of.erase(entity_key(removed->_type, removed->ent_id));
+        removed->_slot = ENTITY_NO_SLOT;
+        if (removed.use_count() > 1) {
+            // Still shared : its state goes to the detached store. The slot
+            // is overwritten by swap_remove, so it is not released
+            removed->move_to_store(EntityStore::detached(), false);
+        } else {
+            // Last reference : the destructor releases the slot, which
+            // swap_remove then fills
+            removed.reset();
+        }
+
+        std::uint32_t last = _entity_list.size() - 1;
+        if (slot != last) {
+            Entity &moved = *_entity_list[last];
+            moved._slot = slot;
+            moved._store_slot = slot;
+            _slot_of[entity_key(moved._type, moved.ent_id)] = slot;
+            _entity_list[slot] = std::move(_entity_list[last]);
+        }
+        _store.swap_remove(slot);
+        _entity_list.pop_back();
+    }
+    _pending_removals.clear();
+
+    // Neighbour indices refer to the old slots
+    _neighbour_table.reset(0);
+    _verlet_candidates.reset(0);
+    _verlet_anchors.clear();
+    _verlet_stale = true;
+}
+
+std::weak_ptr<Entity> World::adopt_entity(std::shared_ptr<Entity> &&entity) {
+    entity->_slot = _entity_list.size();
+    _slot_of[entity_key(entity->_type, entity->ent_id)] = entity->_slot;
+    entity->move_to_store(_store);
+    _previous_state_valid = false;
+    _entity_list.push_back(std::move(entity));
+    return _entity_list.back();
+}
+
+bool World::remove_entity(Entity::Type type, int id) {
+    auto found = _slot_of.find(entity_key(type, id));
+    if (found == _slot_of.end()) {
+        return false;
+    }
+    _pending_removals.push_back(found->second);
+    return true;
+}
+
+std::weak_ptr<Entity> World::find_entity(Entity::Type type, int id) const {
+    auto found = _slot_of.find(entity_key(type, id));
+    if (found == _slot_of.end()) {
+        return std::weak_ptr<Entity>();
+    }
+    return _entity_list[found->second];
 }
 
 std::weak_ptr<Entity> World::add_entity(Entity::Type type, float x, float y) {
@@ -239,13 +566,13 @@ std::weak_ptr<Entity> World::add_entity(Entity::Type type, float x, float y) {
     }
 
     if (x < 0 || y < 0) {
-        auto p_newEnt = Entity::makeEntity(type, next_id, *this);
-        _entity_list.push_back(std::move(p_newEnt));
-        result = _entity_list.back();
+        auto p_newEnt =
+            Entity::makeEntity(_pools, _store, type, next_id, *this);
+        result = adopt_entity(std::move(p_newEnt));
     } else {
-        auto p_newEnt = Entity::makeEntity(type, next_id, *this, x, y);
-        _entity_list.push_back(std::move(p_newEnt));
-        result = _entity_list.back();
+        auto p_newEnt =
+            Entity::makeEntity(_pools, _store, type, next_id, *this, x, y);
+        result = adopt_entity(std::move(p_newEnt));
     }
     _entity_count[type]++;
     return result;
@@ -262,9 +589,9 @@ std::weak_ptr<Entity> World::add_entity(Entity::Type type, float x, float y,
         next_id = 0;
     }
 
-    auto p_newEnt = Entity::makeEntity(type, next_id, *this, x, y, vx, vy);
-    _entity_list.push_back(std::move(p_newEnt));
-    result = _entity_list.back();
+    auto p_newEnt = Entity::makeEntity(_pools, _store, type, next_id, *this, x,
+                                       y, vx, vy);
+    result = adopt_entity(std::move(p_newEnt));
     _entity_count[type]++;
     return result;
 }
@@ -272,54 +599,39 @@ std::weak_ptr<Entity> World::add_entity(Entity::Type type, float x, float y,
 std::weak_ptr<Entity> World::add_entity(std::string json_name, float x, float y,
                                         float vx, float vy) {
     std::weak_ptr<Entity> result;
-    std::string full_path = std::string(DATA_DIR) + "entity/" + json_name;
-    std::fstream fs;
-    fs.open(full_path, std::ios::in);
-    if (!fs.is_open()) {
+    const EntityTemplate *entity_template = _templates.get(json_name);
+    if (entity_template == nullptr) {
         return result;
-    } else {
-        Json::Value json_root;
-        fs >> json_root;
-
-        Entity::Type entity_type;
-        std::string entity_type_string = json_root.get("type", "").asString();
-        if (entity_type_string == "Ant") {
-            entity_type = Entity::Type::ANT;
-        } else if (entity_type_string == "Food") {
-            entity_type = Entity::Type::FOOD;
-        } else {
-            entity_type = Entity::Type::NONE;
-        }
+    }
+    Entity::Type entity_type = entity_template->type;
 
-        int next_id;
-        try {
-            next_id = _entity_count.at(entity_type);
-        } catch (const std::out_of_range &e) {
-            _entity_count[entity_type] = 0;
-            next_id = 0;
-        }
+    int next_id;
+    try {
+        next_id = _entity_count.at(entity_type);
+    } catch (const std::out_of_range &e) {
+        _entity_count[entity_type] = 0;
+        next_id = 0;
+    }
 
-        if (x < 0 || y < 0) {
-            auto p_newEnt =
-                Entity::makeEntity(entity_type, next_id, *this, json_root);
-            _entity_list.push_back(std::move(p_newEnt));
-            result = _entity_list.back();
-        } else {
-            auto p_newEnt = Entity::makeEntity(entity_type, next_id, *this,
-                                               json_root, x, y, vx, vy);
-            _entity_list.push_back(std::move(p_newEnt));
-            result = _entity_list.back();
-        }
-        _entity_count[entity_type]++;
-        return result;
+    if (x < 0 || y < 0) {
+        auto p_newEnt = Entity::makeEntity(_pools, _store, entity_type,
+                                           next_id, *this, *entity_template);
+        result = adopt_entity(std::move(p_newEnt));
+    } else {
+        auto p_newEnt =
+            Entity::makeEntity(_pools, _store, entity_type, next_id, *this,
+                               *entity_template, x, y, vx, vy);
+        result = adopt_entity(std::move(p_newEnt));
     }
+    _entity_count[entity_type]++;
+    return result;
 }
 
 void World::serve_json_event(std::weak_ptr<WorldEvent> event) {
     auto p_event = event.lock();
     if (!p_event) {
-        std::cerr << "World::serve_json_event : Event cannot be served as it "
-                     "is not accessible anymore\n";
+        LOG_WARNING("World::serve_json_event : Event cannot be served as it "
+                    "is not accessible anymore");
         return;
     }
 
@@ -339,12 +651,18 @@ void World::serve_json_event(std::weak_ptr<WorldEvent> event) {
         }
         return;
     } else if (p_event->is_destruction()) {
-        std::cerr
-            << "World::serve_json_event : Destruction is not served yet\n";
+        auto p_destruction = dynamic_cast<DestructionEvent *>(p_event.get());
+        Entity::Type type =
+            Entity::type_from_string(p_destruction->entity_type());
+        if (!remove_entity(type, p_destruction->id())) {
+            LOG_WARNING("World::serve_json_event : No "
+                        << p_destruction->entity_type() << " "
+                        << p_destruction->id() << " to destroy");
+        }
         return;
     } else {
-        std::cerr
-            << "World::serve_json_event : This event type is not recognized\n";
+        LOG_WARNING(
+            "World::serve_json_event : This event type is not recognized");
         return;
     }
 }
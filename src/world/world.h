@@ -15,15 +15,28 @@
 #ifndef WORLD_WORLD_H_
 #define WORLD_WORLD_H_
 #include <Eigen/Dense>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "FlockingConfig.h"
+#include "cellgrid.h"
 #include "entity/entity.h"  // Necessary here to fully declare Entity::Type
+#include "entity/entity_pools.h"
+#include "entity/template_registry.h"
 #include "kdtree.h"
+#include "neighbour_table.h"
+#include "profiler.h"
+#include "random_stream.h"
+#include "render_target.h"
+#include "thread_pool.h"
+#include "triple_buffer.h"
 #include "ui/input/json_event.h"
 
 #define DEFAULT_WORLD_WIDTH 640
@@ -31,15 +44,31 @@
 #define DEFAULT_PIX_WIDTH 640
 #define DEFAULT_PIX_HEIGHT 480
 #define DEFAULT_TIME_STEP 1.0
+#define DEFAULT_WORLD_SEED 0x5EED
+#define WORLD_PHASE_COUNT 7
 
-class MainWindow;
 template class KDTree<Entity>;
+template class CellGrid<Entity>;
 
 // A public struct that contains world-related helpers/definitions
 class World {
  public:
+    // Spatial index used to compute the neighbourhoods
+    enum class SpatialIndex : int { KDTREE, CELL_GRID };
+    // Phases of an update, in the order they run
+    enum class Phase : int {
+        EVENTS,
+        TREE,
+        NEIGHBOURS,
+        DECISION,
+        INTEGRATE,
+        RENDER,
+        REMOVE
+    };
+
     World() = default;
-    World(int w, int h, float dt);
+    World(int w, int h, float dt,
+          SpatialIndex spatial_index = SpatialIndex::KDTREE);
     ~World();
 
     // Width of the world in arbitrary unit
@@ -53,21 +82,41 @@ class World {
     // Time step for the physics engine
     float _time_step{DEFAULT_TIME_STEP};
 
-    // Setter for the MainWindow on which to draw
-    void set_render_window(MainWindow &window);
+    // Setter for the RenderTarget on which to draw
+    void set_render_window(RenderTarget &window);
+    // Stop drawing on the RenderTarget
+    void detach_render_window();
+    // Buffer receiving the frames of publish_frame, for a renderer running
+    // on another thread. nullptr stops publishing
+    void set_frame_buffer(TripleBuffer<RenderFrame> *buffer);
+    // Seed of the random streams of the entities, such as their random
+    // placement. The same seed gives the same initial conditions
+    void set_seed(std::uint64_t seed);
     // Setter for the world size
     void set_world_size(int w, int h);
+    // Size in pixels of the window showing the world. It may be called from
+    // the render thread while another thread updates the world : the size
+    // is only applied at the start of the next update
+    void set_window_size(int width_in_px, int height_in_px);
     // Setter for the time step
     void set_time_step(float t);
+    // Setter for the number of threads used by the update phases, 0 meaning
+    // one per hardware thread. Results do not depend on the thread count
+    void set_thread_count(unsigned thread_count);
+    // Setter for the skin of the Verlet neighbour lists, 0 (the default)
+    // disabling them. With a skin, candidates are searched within
+    // vision_distance + skin and only refreshed once an entity moved more
+    // than skin / 2 ; every tick just filters the candidates
+    void set_verlet_skin(float skin);
     // Translate position in place so the world wraps around edges
-    void wrap_around(Eigen::Vector2d &position);
+    void wrap_around(Eigen::Vector2d &position) const;
     // Translate arbitrary unit to pixels position for the renderer
     Eigen::Vector2d convert(const Eigen::Vector2d &position) const;
     // Computes the vector to go from tail to head
     // This only work on 'wrapped_around' vectors, for which coord
     //   lie in [0 ; width] x [0 ; height]
     Eigen::Vector2d point_to(const Eigen::Vector2d &tail,
-                             const Eigen::Vector2d &head);
+                             const Eigen::Vector2d &head) const;
 
     // Add a new entity to the world, with an optional location
     // Location is expected to lie in [0;width] X [0;height]
@@ -83,44 +132,208 @@ class World {
     std::weak_ptr<Entity> add_entity(std::string json_name, float x = -1,
                                      float y = -1, float vx = 0, float vy = 0);
 
+    // Queue the removal of the entity of the given type and id. Removals are
+    // applied together at the end of the update (see apply_removals), so
+    // the entity still takes part in the current tick. Return false if
+    // there is no such entity
+    bool remove_entity(Entity::Type type, int id);
+    // Entity of the given type and id, in constant time. Empty if there is
+    // no such entity
+    std::weak_ptr<Entity> find_entity(Entity::Type type, int id) const;
+    // Handle on an entity of the world, that stays safe to resolve after
+    // the entity is destroyed
+    inline EntityHandle handle(const Entity &entity) const {
+        return _pools.handle(entity);
+    }
+    // Entity of the handle, nullptr if it was destroyed since
+    inline Entity *resolve(EntityHandle handle) const {
+        return _pools.get(handle);
+    }
+    // Number of removals waiting for apply_removals
+    inline std::size_t pending_removals() const {
+        return _pending_removals.size();
+    }
+
+    // Load every entity template of the data directory now, so that later
+    // spawns do no I/O. Return the number of templates loaded
+    inline std::size_t preload_templates() { return _templates.preload(); }
+
     // Add events from json input stream, with default behaviour of overwriting
     // current event list
     inline void add_events(std::istream &in, bool append = false) {
         _events.read_istream(in, append);
     }
+    // Pull the events lazily from the file at path as time goes, instead of
+    // reading them all now. The events of the file must be sorted by
+    // time_stamp. Return false if the file cannot be opened
+    inline bool stream_events(const std::string &path) {
+        return _events.stream_file(path);
+    }
+
+    // Write the whole state of the world to path as a binary snapshot (see
+    // snapshot.h) : time, dimensions, seed, kinematic state and parameters
+    // of the entities, and pending events. The file is laid out in memory
+    // and written at once to a temporary file, synced to the disk, then
+    // renamed over path. Events still in a stream (see stream_events) are
+    // read ahead without being pulled. Return false on failure
+    bool save_snapshot(const std::string &path);
+    // Replace the state of the world with a snapshot of save_snapshot. The
+    // file is memory-mapped and its records read in place. On failure the
+    // world is left untouched and false is returned
+    bool load_snapshot(const std::string &path);
 
     // Calls update on every entity and then send everything to renderer
     void update();
     // Find and serve all new json events that happened
     void find_and_serve_new_events();
-    // Update the k-d tree
+    // Rebuild the spatial index from the current entity positions
     void update_tree();
     // Compute the neighbourhoods of each entity
     void update_entity_neighbourhoods();
-    // Call the decision method of each entity (alone in its loop because
-    // Entity::update changes position while we're looping
+    // Call the decision method of each entity, in parallel. Decisions see the
+    // state of the previous tick only
     void call_entity_decision();
     // Update each entity
     void update_entity_and_renderer();
+    // Send every entity to the render window, if any, as one batch
+    void submit_to_renderer();
+    // Fill the back frame of the frame buffer, if any, with the current and
+    // previous state and publish it. due is the wall-clock time at which the
+    // current state is due (see RenderFrame). It is meant to be called by
+    // the loop driving the updates, once after the updates of an iteration
+    void publish_frame(double due = 0);
+    // Integrate the kinematic state of every entity in the store, in
+    // parallel, then publish it
+    void integrate_store();
+    // Remove the entities queued by remove_entity in one pass. Each removed
+    // slot is filled with the last entity of the list, so the entity list
+    // and the store stay dense and aligned. Slots of the remaining entities
+    // may change
+    void apply_removals();
 
     // Serve a pointed-to event
     void serve_json_event(std::weak_ptr<WorldEvent> event);
 
     // Accessors
-    MainWindow &get_mut_window();
+    RenderTarget &get_mut_window();
     inline const auto &entity_list() const { return _entity_list; }
+    inline const EntityStore &store() const { return _store; }
+    inline const EntityPools &pools() const { return _pools; }
+    inline const WorldEventsList &events() const { return _events; }
+    // Templates used by add_entity(std::string json_name, ...)
+    inline TemplateRegistry &templates() { return _templates; }
     inline float time_step() const { return _time_step; }
     inline double time() const { return _time; }
+    // Number of updates done
+    inline std::uint64_t tick() const { return _tick; }
+    inline SpatialIndex spatial_index() const { return _spatial_index; }
+    inline unsigned thread_count() const { return _pool->size(); }
+    inline float verlet_skin() const { return _verlet_skin; }
+    // Number of times the Verlet candidates were searched
+    inline std::uint64_t verlet_rebuilds() const { return _verlet_rebuilds; }
+    inline std::uint64_t seed() const { return _seed; }
+    // Random stream of the entity of the given type and id. It only depends
+    // on the seed, the type and the id, not on the order of creation
+    inline RandomStream random_stream(Entity::Type type, int id) const {
+        return RandomStream(_seed, entity_key(type, id));
+    }
+    // Key identifying an entity within a World
+    static inline std::uint64_t entity_key(Entity::Type type, int id) {
+        return (static_cast<std::uint64_t>(type) << 32) |
+               static_cast<std::uint32_t>(id);
+    }
+    // Wall-clock duration of a phase during the last update, in seconds
+    inline double phase_duration(Phase phase) const {
+        return _profiler.last(static_cast<int>(phase));
+    }
+    // Durations of the phases over the last updates
+    inline const Profiler &profiler() const { return _profiler; }
+    static const char *phase_name(Phase phase);
+    // Names of all the phases, in order
+    static std::vector<std::string> phase_names();
+    // Neighbours of the entity in slot, empty until the next computation of
+    // the neighbourhoods if the entity is new
+    inline NeighbourView neighbour_view(std::uint32_t slot) {
+        return _neighbour_table.view(slot, _entity_list.data());
+    }
+    inline const NeighbourTable &neighbour_table() const {
+        return _neighbour_table;
+    }
 
  protected:
+    // Kinematic state of the entities, slot i belongs to _entity_list[i].
+    // Declared first so it outlives the entities
+    EntityStore _store{};
+    // Memory of the entities, declared before them for the same reason
+    EntityPools _pools{};
     std::vector<std::shared_ptr<Entity>> _entity_list{};
+    // Slot of each entity, by entity_key
+    std::unordered_map<std::uint64_t, std::uint32_t> _slot_of{};
+    // Slots queued by remove_entity
+    std::vector<std::uint32_t> _pending_removals{};
+    SpatialIndex _spatial_index{SpatialIndex::KDTREE};
     KDTree<Entity> _entity_tree{};
+    CellGrid<Entity> _entity_grid{};
+    NeighbourTable _neighbour_table{};
+    // Threads running the parallel phases
+    std::unique_ptr<ThreadPool> _pool{new ThreadPool(1)};
+    // Neighbour rows computed by each thread, gathered in a table
+    std::vector<NeighbourTable> _neighbour_parts{};
+    // Verlet lists : skin, candidate neighbours, and position and vision of
+    // each entity when the candidates were searched
+    float _verlet_skin{0};
+    NeighbourTable _verlet_candidates{};
+    EntityStore::Vectors _verlet_anchors{};
+    std::vector<float> _verlet_visions{};
+    // True when update_tree found the candidates out of date
+    bool _verlet_stale{true};
+    std::uint64_t _verlet_rebuilds{0};
     WorldEventsList _events{};
+    TemplateRegistry _templates{std::string(DATA_DIR) + "entity/"};
     std::map<Entity::Type, int> _entity_count;
-    // Pointer to the MainWindow on which to draw
-    MainWindow *_render_window{nullptr};
+    // Pointer to the RenderTarget on which to draw, if any
+    RenderTarget *_render_window{nullptr};
+    // Frames for a renderer on another thread, if any
+    TripleBuffer<RenderFrame> *_frame_buffer{nullptr};
+    // Number of updates done
+    std::uint64_t _tick{0};
+    // True if the back buffers of the store hold the state before the last
+    // integration for every entity
+    bool _previous_state_valid{false};
+    // Seed of the random streams of the entities
+    std::uint64_t _seed{DEFAULT_WORLD_SEED};
+    // Duration of each phase of the updates
+    Profiler _profiler{phase_names()};
     // Elapsed time
     double _time{0};
+    // Window size of the last set_window_size not applied yet, the width
+    // in the high half and the height in the low half. 0 when none
+    std::atomic<std::uint64_t> _pending_window_size{0};
+
+    // Put a new entity at the end of the entity list and of the store. The
+    // entities made with _store already hold the last slot of the store
+    std::weak_ptr<Entity> adopt_entity(std::shared_ptr<Entity> &&entity);
+    // Drop every entity. Entities still shared outside of the world keep
+    // their kinematic state in the detached store
+    void clear_entities();
+    // Fill table with the entities within vision_distance + margin of each
+    // entity, from a built spatial index. Without margin, the entities with
+    // a vision cone only get the neighbours within it
+    template <typename Index>
+    void compute_neighbourhoods(const Index &index, NeighbourTable &table,
+                                float margin = 0);
+    // Fill one row of table per entity, splitting the entity list across the
+    // thread pool. fill_rows(first, last, part) appends to part the rows of
+    // the slots in [first ; last[
+    template <typename F>
+    void fill_table(NeighbourTable &table, F &&fill_rows);
+    // Minimum image vector going from tail to head, both being wrapped
+    Eigen::Vector2d periodic_offset(const Eigen::Vector2d &tail,
+                                    const Eigen::Vector2d &head) const;
+    // True if the Verlet candidates cannot be trusted anymore
+    bool verlet_candidates_stale() const;
+    // Keep the candidates that are within vision_distance now
+    void filter_verlet_candidates();
 };
 
 #endif  // WORLD_WORLD_H_
@@ -13,4 +13,6 @@
  */
 
 #define CATCH_CONFIG_MAIN
+// Catch 2.x alternate signal stack does not build against glibc >= 2.34
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include "catch.hpp"
@@ -0,0 +1,181 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "catch.hpp"
+#include "entity/ant/boids_kernel.h"
+
+namespace {
+BoidsQuery make_query(double exponent) {
+    BoidsQuery query;
+    query.x = 10;
+    query.y = 490;
+    query.direction_x = std::sqrt(0.5);
+    query.direction_y = -std::sqrt(0.5);
+    query.radius_squared = 60 * 60;
+    query.cos_threshold = std::cos(2.0);
+    query.width = 800;
+    query.height = 500;
+    query.half_width = 400;
+    query.half_height = 250;
+    query.separation_offset = 15;
+    query.separation_exponent = exponent;
+    return query;
+}
+
+// Neighbours scattered around the query, some across the world edges, with
+// one standing on the query itself
+void fill_lanes(BoidsLanes &lanes, std::size_t count, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> offset(-80, 80);
+    std::uniform_real_distribution<double> speed(-3, 3);
+    lanes.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        lanes.x[i] = 10 + offset(generator);
+        lanes.y[i] = 490 + offset(generator);
+        lanes.vx[i] = speed(generator);
+        lanes.vy[i] = speed(generator);
+    }
+    lanes.x[count / 2] = 10;
+    lanes.y[count / 2] = 490;
+}
+}  // namespace
+
+TEST_CASE("Scalar boids kernel applies the vision mask and the sums",
+          "[boids_kernel]") {
+    BoidsQuery query = make_query(1);
+    query.cos_threshold = 0;
+    BoidsLanes lanes;
+    lanes.resize(4);
+    // Ahead, behind, too far, and on the ant itself
+    double xs[4] = {20, 0, 100, 10};
+    double ys[4] = {480, 500, 400, 490};
+    for (int i = 0; i < 4; ++i) {
+        lanes.x[i] = xs[i];
+        lanes.y[i] = ys[i];
+        lanes.vx[i] = i + 1;
+        lanes.vy[i] = -(i + 1);
+    }
+    BoidsSums sums;
+    boids_kernel(BoidsIsa::SCALAR)(query, lanes, 4, sums);
+
+    REQUIRE(lanes.seen[0] == 1);
+    REQUIRE(lanes.seen[1] == 0);
+    REQUIRE(lanes.seen[2] == 0);
+    REQUIRE(lanes.seen[3] == 1);
+    REQUIRE(sums.count == 2);
+    REQUIRE(sums.cohesion[0] == Approx(10));
+    REQUIRE(sums.cohesion[1] == Approx(-10));
+    REQUIRE(sums.alignment[0] == Approx(5));
+    REQUIRE(sums.alignment[1] == Approx(-5));
+    // The ant itself does not push away
+    double distance = std::sqrt(200.0);
+    double factor = 1 / (distance * (distance + 15));
+    REQUIRE(sums.separation[0] == Approx(-10 * factor));
+    REQUIRE(sums.separation[1] == Approx(10 * factor));
+}
+
+TEST_CASE("Boids kernels see neighbours across the world edges",
+          "[boids_kernel]") {
+    BoidsQuery query = make_query(1);
+    // Near the corner, looking across both seams
+    query.x = 1;
+    query.y = 1;
+    query.direction_x = -std::sqrt(0.5);
+    query.direction_y = -std::sqrt(0.5);
+    query.cos_threshold = 0.5;
+    // Across x = 0, across y = 0, across both, behind, on the ant itself,
+    // too far, across x = 0 further away, and behind across nothing
+    double xs[8] = {795, 1, 795, 10, 1, 400, 780, 1};
+    double ys[8] = {1, 495, 495, 10, 1, 250, 1, 60};
+    std::uint8_t expected[8] = {1, 1, 1, 0, 1, 0, 1, 0};
+
+    for (BoidsIsa isa : {BoidsIsa::SCALAR, BoidsIsa::SSE2, BoidsIsa::AVX2}) {
+        BoidsKernel kernel = boids_kernel(isa);
+        if (kernel == nullptr) {
+            WARN(boids_isa_name(isa) << " is not supported");
+            continue;
+        }
+        INFO(boids_isa_name(isa));
+        BoidsLanes lanes;
+        lanes.resize(8);
+        for (int i = 0; i < 8; ++i) {
+            lanes.x[i] = xs[i];
+            lanes.y[i] = ys[i];
+            lanes.vx[i] = 1;
+            lanes.vy[i] = 2;
+        }
+        BoidsSums sums;
+        kernel(query, lanes, 8, sums);
+
+        for (int i = 0; i < 8; ++i) {
+            INFO("neighbour " << i);
+            CHECK(lanes.seen[i] == expected[i]);
+        }
+        REQUIRE(sums.count == 5);
+        REQUIRE(sums.cohesion[0] == Approx(-33));
+        REQUIRE(sums.cohesion[1] == Approx(-12));
+        REQUIRE(sums.alignment[0] == Approx(5));
+        REQUIRE(sums.alignment[1] == Approx(10));
+        // Pushed back from the corner
+        REQUIRE(sums.separation[0] > 0);
+        REQUIRE(sums.separation[1] > 0);
+    }
+}
+
+TEST_CASE("Vector boids kernels agree with the scalar kernel",
+          "[boids_kernel]") {
+    REQUIRE(boids_isa_supported(BoidsIsa::SCALAR));
+    REQUIRE(boids_kernel(boids_best_isa()) == boids_best_kernel());
+
+    for (double exponent : {0.0, 0.25, 0.5, 1.0, 1.7}) {
+        // Odd count so the vector kernels also run their tail
+        for (std::size_t count : {1, 3, 37}) {
+            BoidsQuery query = make_query(exponent);
+            BoidsLanes reference_lanes;
+            fill_lanes(reference_lanes, count, 7 * count);
+            BoidsSums reference;
+            boids_kernel(BoidsIsa::SCALAR)(query, reference_lanes, count,
+                                           reference);
+
+            for (BoidsIsa isa : {BoidsIsa::SSE2, BoidsIsa::AVX2}) {
+                BoidsKernel kernel = boids_kernel(isa);
+                if (kernel == nullptr) {
+                    WARN(boids_isa_name(isa) << " is not supported");
+                    continue;
+                }
+                INFO(boids_isa_name(isa) << " exponent " << exponent
+                                         << " count " << count);
+                BoidsLanes lanes;
+                fill_lanes(lanes, count, 7 * count);
+                BoidsSums sums;
+                kernel(query, lanes, count, sums);
+
+                REQUIRE(lanes.seen == reference_lanes.seen);
+                REQUIRE(sums.count == reference.count);
+                for (int dim = 0; dim < 2; ++dim) {
+                    REQUIRE(sums.cohesion[dim] ==
+                            Approx(reference.cohesion[dim]));
+                    REQUIRE(sums.alignment[dim] ==
+                            Approx(reference.alignment[dim]));
+                    REQUIRE(sums.separation[dim] ==
+                            Approx(reference.separation[dim]));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,145 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "catch.hpp"
+#include "entity/ant/ant.h"
+#include "entity/entity.h"
+#include "entity/food/food.h"
+#include "world/cellgrid.h"
+#include "world/kdtree.h"
+
+template class CellGrid<Entity>;
+
+TEST_CASE("Cell grid build", "[cellgrid][build]") {
+    std::vector<std::shared_ptr<Entity>> entities;
+    for (int i = 0; i < 30; ++i) {
+        entities.emplace_back(Entity::makeEntity(
+            Entity::Type::ANT, 3.3 * i, 1.7 * ((7 * i) % 30)));
+    }
+    CellGrid<Entity> grid;
+    grid.set_cell_size(10);
+    grid.set_periodic_domain(100, 51);
+    grid.build(entities);
+
+    SECTION("Every entity is bucketed and cells tile the domain") {
+        REQUIRE(grid.size() == entities.size());
+        CHECK(grid.cell_count(0) == 10);
+        CHECK(grid.cell_count(1) == 5);
+    }
+
+    SECTION("Cleaning empties the grid") {
+        grid.clean();
+        REQUIRE(grid.size() == 0);
+        std::vector<std::uint32_t> result;
+        grid.norm1_range_query(entities[0]->pos(), 10, result);
+        REQUIRE(result.empty());
+    }
+}
+
+TEST_CASE("Cell grid agrees with the k-d tree", "[cellgrid][range_query]") {
+    std::vector<std::shared_ptr<Entity>> entities;
+    for (int i = 0; i < 200; ++i) {
+        entities.emplace_back(Entity::makeEntity(
+            Entity::Type::ANT, (37 * i) % 200 * 0.5, (91 * i) % 157 * 0.5));
+    }
+    KDTree<Entity> tree;
+    tree.set_periodic_domain(100, 80);
+    tree.build(entities);
+    CellGrid<Entity> grid;
+    grid.set_cell_size(12);
+    grid.set_periodic_domain(100, 80);
+    grid.build(entities);
+
+    SECTION("Plain range queries") {
+        Eigen::Vector2d center(47.0, 33.0);
+        std::vector<std::uint32_t> from_tree;
+        std::vector<std::uint32_t> from_grid;
+        tree.norm1_range_query(center, 12, from_tree);
+        grid.norm1_range_query(center, 12, from_grid);
+        std::sort(from_tree.begin(), from_tree.end());
+        std::sort(from_grid.begin(), from_grid.end());
+        REQUIRE(!from_grid.empty());
+        REQUIRE(from_tree == from_grid);
+    }
+
+    SECTION("Periodic range queries, including radii over the domain") {
+        for (float radius : {3.0f, 12.0f, 45.0f, 300.0f}) {
+            for (auto&& ent : entities) {
+                std::vector<std::uint32_t> from_tree;
+                std::vector<std::uint32_t> from_grid;
+                tree.periodic_range_visit(
+                    ent->pos(), radius,
+                    [&](std::uint32_t index, const Eigen::Vector2d&) {
+                        from_tree.push_back(index);
+                    });
+                grid.periodic_range_visit(
+                    ent->pos(), radius,
+                    [&](std::uint32_t index, const Eigen::Vector2d&) {
+                        from_grid.push_back(index);
+                    });
+                std::sort(from_tree.begin(), from_tree.end());
+                std::sort(from_grid.begin(), from_grid.end());
+                REQUIRE(from_tree == from_grid);
+            }
+        }
+    }
+
+    SECTION("Cone queries keep the range query entities in the cone") {
+        VisionCone cone;
+        for (double degrees : {0.0, 30.0, 60.0, 90.0, 135.0, 180.0}) {
+            cone.cos_threshold =
+                degrees >= 180 ? -2 : std::cos(degrees * M_PI / 180);
+            for (float radius : {3.0f, 12.0f, 45.0f, 300.0f}) {
+                cone.radius = radius;
+                for (std::size_t i = 0; i < entities.size(); i += 7) {
+                    cone.apex = entities[i]->pos();
+                    double angle = 0.37 * i;
+                    cone.direction << std::cos(angle), std::sin(angle);
+                    std::vector<std::uint32_t> expected;
+                    std::vector<std::uint32_t> from_tree;
+                    std::vector<std::uint32_t> from_grid;
+                    tree.periodic_range_visit(
+                        cone.apex, radius,
+                        [&](std::uint32_t index,
+                            const Eigen::Vector2d& offset) {
+                            if (cone.contains(offset)) {
+                                expected.push_back(index);
+                            }
+                        });
+                    tree.periodic_cone_visit(
+                        cone, [&](std::uint32_t index,
+                                  const Eigen::Vector2d& offset) {
+                            REQUIRE(cone.contains(offset));
+                            from_tree.push_back(index);
+                        });
+                    grid.periodic_cone_visit(
+                        cone, [&](std::uint32_t index,
+                                  const Eigen::Vector2d&) {
+                            from_grid.push_back(index);
+                        });
+                    std::sort(expected.begin(), expected.end());
+                    std::sort(from_tree.begin(), from_tree.end());
+                    std::sort(from_grid.begin(), from_grid.end());
+                    REQUIRE(from_tree == expected);
+                    REQUIRE(from_grid == expected);
+                }
+            }
+        }
+    }
+}
@@ -13,6 +13,7 @@
  */
 
 #include <Eigen/Dense>
+#include <sstream>
 #include "catch.hpp"
 #include "entity/ant/ant.h"
 #include "entity/entity.h"
@@ -56,8 +57,12 @@ TEST_CASE("Ant json writing", "[ant][json]") {
     ant_1.set_mass(2.3);
     ant_1.set_max_acceleration(25.7);
     ant_1.set_cruise_speed(20);
-    ant_1.update_json();
-    Json::Value ant_json = ant_1.json();
+    std::stringstream out;
+    ant_1.write_json(out);
+    Json::Value ant_json;
+    Json::CharReaderBuilder builder;
+    std::string errors;
+    REQUIRE(Json::parseFromStream(builder, out, &ant_json, &errors));
 
     CHECK(ant_json["type"] == "Ant");
     CHECK(ant_json["id"] == 1);
@@ -102,6 +107,37 @@ TEST_CASE("Ant json writing", "[ant][json]") {
     CHECK(ant_json["colors"]["capped_force"][3] == 0xFF);
 }
 
+TEST_CASE("Ant json round trip", "[ant][json]") {
+    World world(640, 480, 1);
+    Ant ant_1(1, world, 50.0, 31.0, 0.8, -0.5, 0, 0);
+    ant_1.set_vision_angle_deg(33.3);
+    ant_1.set_size(8, 7.9);
+    ant_1.set_mass(2.3);
+    ant_1.set_friction_factor(0.1);
+    ant_1.set_cohesion_weight(0.15);
+    ant_1.blind_color[1] = 0x12;
+
+    std::stringstream out;
+    ant_1.write_json(out);
+    Json::Value root;
+    Json::CharReaderBuilder builder;
+    std::string errors;
+    REQUIRE(Json::parseFromStream(builder, out, &root, &errors));
+
+    Ant ant_2(2, world, root);
+    CHECK(ant_2.type() == Entity::Type::ANT);
+    CHECK(ant_2.size()(0) == ant_1.size()(0));
+    CHECK(ant_2.size()(1) == ant_1.size()(1));
+    CHECK(ant_2.mass() == ant_1.mass());
+    CHECK(ant_2.friction_factor() == ant_1.friction_factor());
+    CHECK(ant_2.vision_distance() == ant_1.vision_distance());
+    CHECK(ant_2.ant_params().vision_angle_degrees ==
+          ant_1.ant_params().vision_angle_degrees);
+    CHECK(ant_2.ant_params().cohesion_weight ==
+          ant_1.ant_params().cohesion_weight);
+    CHECK(ant_2.blind_color[1] == 0x12);
+}
+
 TEST_CASE("Ant vision", "[ant][vision]") {
     World world(640, 480, 1);
     Ant ant_1(1, world, 50.0, 31.0, 0.8, -0.5, 0, 0);
@@ -163,10 +199,6 @@ TEST_CASE("Ant decision", "[ant][decision]") {
         ant_1->set_cohesion_weight(0);
         world.update_tree();
         world.update_entity_neighbourhoods();
-        REQUIRE(ant_1->decision_alignment_velocity()(0) ==
-                Approx(std::sqrt(2)));
-        REQUIRE(ant_1->decision_alignment_velocity()(1) ==
-                Approx(std::sqrt(2)));
         world.call_entity_decision();
         world.update_entity_and_renderer();
         REQUIRE(ant_1->neighbours().size() == 2);
@@ -180,8 +212,6 @@ TEST_CASE("Ant decision", "[ant][decision]") {
         ant_1->set_cohesion_weight(1);
         world.update_tree();
         world.update_entity_neighbourhoods();
-        REQUIRE(ant_1->decision_cohesion_velocity()(0) == Approx(std::sqrt(2)));
-        REQUIRE(ant_1->decision_cohesion_velocity()(1) == Approx(std::sqrt(2)));
         world.call_entity_decision();
         world.update_entity_and_renderer();
         REQUIRE(ant_1->neighbours().size() == 2);
@@ -15,6 +15,7 @@
 #include <Eigen/Dense>
 #include <fstream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include "FlockingConfig.h"
 #include "catch.hpp"
@@ -82,3 +83,106 @@ TEST_CASE("WorldEventsList construction", "[events][json_read]") {
     }
 
 }
+
+// Events document with count creations, one every 0.5 time unit
+static std::string sorted_events(int count) {
+    std::ostringstream out;
+    out << "{\"comment\": \"events [not here]\", \"events\": [";
+    for (int i = 0; i < count; ++i) {
+        out << (i > 0 ? ",\n" : "\n") << "{\"time_stamp\": " << 0.5 * i
+            << ", \"creation\": {\"type\": \"ant_{default}.json\"}}";
+    }
+    out << "\n]}";
+    return out.str();
+}
+
+TEST_CASE("WorldEventsList serves each event once", "[events][cursor]") {
+    std::fstream sample_events_file;
+    sample_events_file.open(std::string(DATA_DIR) + "events/event_sample.json",
+                            std::ios::in);
+    REQUIRE(sample_events_file.is_open());
+    WorldEventsList test_list(sample_events_file);
+
+    std::size_t served = 0;
+    auto count = [&](const std::shared_ptr<WorldEvent>&) { ++served; };
+    CHECK(test_list.serve(0, 2.6, count) == 1);
+    // Overlapping frames do not serve an event twice
+    CHECK(test_list.serve(2, 2.9, count) == 0);
+    CHECK(test_list.serve(2.9, 3.5, count) == 2);
+    CHECK(served == 3);
+    CHECK(test_list.cursor() == 3);
+
+    SECTION("Seek goes back") {
+        test_list.seek(2.7);
+        CHECK(test_list.cursor() == 1);
+        CHECK(test_list.serve(2.7, 10, count) == 2);
+    }
+
+    SECTION("A gap between two frames does not lose events") {
+        test_list.append(std::make_shared<CreationEvent>(3.6, "ant.json"));
+        CHECK(test_list.serve(3.7, 4, count) == 1);
+    }
+
+    SECTION("Events added in the past are not served") {
+        test_list.append(std::make_shared<CreationEvent>(1.0, "ant.json"));
+        test_list.append(std::make_shared<CreationEvent>(4.0, "ant.json"));
+        CHECK(test_list.serve(3.5, 4.5, count) == 1);
+    }
+}
+
+TEST_CASE("WorldEventsList streams events lazily", "[events][stream]") {
+    const int count = 5000;
+    WorldEventsList test_list;
+    test_list.stream_istream(std::unique_ptr<std::istream>(
+        new std::istringstream(sorted_events(count))));
+    REQUIRE(test_list.is_streaming());
+
+    std::size_t served = 0;
+    std::size_t largest_list = 0;
+    std::string name;
+    float time = 0;
+    while (served < static_cast<std::size_t>(count)) {
+        served += test_list.serve(time, time + 1,
+                                  [&](const std::shared_ptr<WorldEvent>& e) {
+                                      auto creation =
+                                          static_cast<CreationEvent*>(e.get());
+                                      name = creation->json_template_name();
+                                  });
+        largest_list = std::max(largest_list, test_list.list().size());
+        time += 1;
+        REQUIRE(time < count);
+    }
+    CHECK(served == static_cast<std::size_t>(count));
+    CHECK(name == "ant_{default}.json");
+    CHECK_FALSE(test_list.is_streaming());
+    // Served events are dropped, the whole file is never held
+    CHECK(largest_list < static_cast<std::size_t>(count));
+}
+
+TEST_CASE("WorldEventsList visits pending events without pulling them",
+          "[events][stream]") {
+    const int count = 300;
+    WorldEventsList test_list;
+    test_list.stream_istream(std::unique_ptr<std::istream>(
+        new std::istringstream(sorted_events(count))));
+    auto ignore = [](const std::shared_ptr<WorldEvent>&) {};
+    std::size_t served = test_list.serve(0, 20, ignore);
+    REQUIRE(served == 40);
+    std::size_t held = test_list.list().size();
+
+    std::size_t pending = 0;
+    float first = -1;
+    test_list.for_each_pending([&](const std::shared_ptr<WorldEvent>& e) {
+        if (pending++ == 0) {
+            first = e->time_stamp();
+        }
+    });
+    CHECK(pending == count - served);
+    CHECK(first == 20);
+    CHECK(test_list.list().size() == held);
+    REQUIRE(test_list.is_streaming());
+
+    // The stream goes on from where it was
+    served += test_list.serve(20, count, ignore);
+    CHECK(served == static_cast<std::size_t>(count));
+}
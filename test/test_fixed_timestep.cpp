@@ -0,0 +1,39 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+#include "world/fixed_timestep.h"
+
+TEST_CASE("Fixed timestep runs whole steps", "[fixed_timestep]") {
+    FixedTimestep timestep(0.25, 4);
+    CHECK(timestep.advance(0.1) == 0);
+    CHECK(timestep.alpha() == Approx(0.4));
+    CHECK(timestep.advance(0.2) == 1);
+    CHECK(timestep.accumulator() == Approx(0.05));
+    CHECK(timestep.time_to_next_step() == Approx(0.2));
+    CHECK(timestep.advance(0.7) == 3);
+    CHECK(timestep.accumulator() == Approx(0));
+    CHECK(timestep.dropped_steps() == 0);
+    // Time going backwards is ignored
+    CHECK(timestep.advance(-1) == 0);
+}
+
+TEST_CASE("Fixed timestep caps the catch-up", "[fixed_timestep]") {
+    FixedTimestep timestep(0.1, 3);
+    // A ten steps stall only runs the allowed steps and drops the rest
+    CHECK(timestep.advance(1.05) == 3);
+    CHECK(timestep.dropped_steps() == 7);
+    CHECK(timestep.accumulator() == Approx(0.05));
+    CHECK(timestep.advance(0.05) == 1);
+}
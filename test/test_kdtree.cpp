@@ -14,6 +14,7 @@
 
 #include <Eigen/Dense>
 #include <algorithm>
+#include <cmath>
 #include <memory>
 #include "catch.hpp"
 #include "entity/ant/ant.h"
@@ -237,3 +238,197 @@ TEST_CASE("Range Query in the kdtree", "[kdtree][range_query]") {
         REQUIRE(result.size() == 0);
     }
 }
+
+TEST_CASE("Bulk-built tree", "[kdtree][build]") {
+    std::vector<std::shared_ptr<Entity>> entities;
+    for (int i = 0; i < 20; ++i) {
+        for (int j = 0; j < 15; ++j) {
+            entities.emplace_back(Entity::makeEntity(
+                Entity::Type::ANT, 3.0 * i + 0.1 * j, 2.0 * j + 0.05 * i));
+        }
+    }
+    KDTree<Entity> tree;
+    tree.build(entities);
+
+    SECTION("Every entity gets a node") {
+        REQUIRE(tree.flat_size() == entities.size());
+        REQUIRE(tree.root() == nullptr);
+    }
+
+    SECTION("Range queries match a brute force search") {
+        Eigen::Vector2d center(31.0, 14.5);
+        float radius = 7.5;
+        auto result = tree.norm1_range_query(center, radius);
+
+        std::size_t expected = 0;
+        for (auto&& ent : entities) {
+            Eigen::Vector2d diff = ent->pos() - center;
+            bool inside = std::abs(diff(0)) <= radius &&
+                          std::abs(diff(1)) <= radius;
+            if (inside) {
+                ++expected;
+            }
+            CHECK((std::find_if(result.begin(), result.end(),
+                                [&](const auto& arg) -> bool {
+                                    return arg.lock() == ent;
+                                }) != result.end()) == inside);
+        }
+        REQUIRE(result.size() == expected);
+    }
+
+    SECTION("Cleaning and rebuilding") {
+        tree.clean();
+        REQUIRE(tree.flat_size() == 0);
+        REQUIRE(tree.norm1_range_query(entities[0]->pos(), 1.0).size() == 0);
+        tree.build(entities);
+        REQUIRE(tree.flat_size() == entities.size());
+        REQUIRE(tree.norm1_range_query(entities[0]->pos(), 0.01).size() == 1);
+    }
+}
+
+TEST_CASE("Visitor range queries", "[kdtree][range_visit]") {
+    std::vector<std::shared_ptr<Entity>> entities;
+    for (int i = 0; i < 40; ++i) {
+        entities.emplace_back(Entity::makeEntity(
+            Entity::Type::ANT, 7.3 * (i % 8), 5.9 * (i / 8)));
+    }
+    KDTree<Entity> tree;
+    tree.build(entities);
+    Eigen::Vector2d center(20.0, 12.0);
+    float radius = 9.0;
+    auto expected = tree.norm1_range_query(center, radius);
+
+    SECTION("Visitor sees the same entities as the vector query") {
+        std::vector<std::uint32_t> visited;
+        tree.norm1_range_visit(center, radius, [&](std::uint32_t index) {
+            visited.push_back(index);
+        });
+        REQUIRE(visited.size() == expected.size());
+        for (auto&& index : visited) {
+            CHECK(std::find_if(expected.begin(), expected.end(),
+                               [&](const auto& arg) -> bool {
+                                   return arg.lock() == entities[index];
+                               }) != expected.end());
+        }
+    }
+
+    SECTION("Output buffer is appended to") {
+        std::vector<std::uint32_t> buffer{999};
+        tree.norm1_range_query(center, radius, buffer);
+        REQUIRE(buffer.size() == expected.size() + 1);
+        CHECK(buffer[0] == 999);
+    }
+}
+
+TEST_CASE("Periodic range queries", "[kdtree][periodic]") {
+    std::vector<std::shared_ptr<Entity>> entities;
+    entities.emplace_back(Entity::makeEntity(Entity::Type::ANT, 2.0, 3.0));
+    entities.emplace_back(Entity::makeEntity(Entity::Type::ANT, 97.0, 3.0));
+    entities.emplace_back(Entity::makeEntity(Entity::Type::ANT, 2.0, 48.0));
+    entities.emplace_back(Entity::makeEntity(Entity::Type::ANT, 98.0, 49.0));
+    entities.emplace_back(Entity::makeEntity(Entity::Type::ANT, 50.0, 25.0));
+    KDTree<Entity> tree;
+    tree.set_periodic_domain(100, 50);
+    tree.build(entities);
+
+    SECTION("Neighbours across the corner are found once with their offset") {
+        std::vector<std::uint32_t> visited;
+        std::vector<Eigen::Vector2d> offsets;
+        tree.periodic_range_visit(
+            entities[0]->pos(), 6.0,
+            [&](std::uint32_t index, const Eigen::Vector2d& offset) {
+                visited.push_back(index);
+                offsets.push_back(offset);
+            });
+        REQUIRE(visited.size() == 4);
+        for (std::size_t i = 0; i < visited.size(); ++i) {
+            Eigen::Vector2d expected(0, 0);
+            switch (visited[i]) {
+                case 1:
+                    expected << -5.0, 0.0;
+                    break;
+                case 2:
+                    expected << 0.0, -5.0;
+                    break;
+                case 3:
+                    expected << -4.0, -4.0;
+                    break;
+                default:
+                    REQUIRE(visited[i] == 0);
+            }
+            CHECK(offsets[i](0) == Approx(expected(0)));
+            CHECK(offsets[i](1) == Approx(expected(1)));
+        }
+    }
+
+    SECTION("A radius larger than the domain sees everything once") {
+        std::size_t count = 0;
+        tree.periodic_range_visit(
+            entities[4]->pos(), 500.0,
+            [&](std::uint32_t, const Eigen::Vector2d&) { ++count; });
+        REQUIRE(count == entities.size());
+    }
+}
+
+TEST_CASE("Vision cone queries", "[kdtree][cone]") {
+    VisionCone cone;
+    cone.apex << 20.0, 12.0;
+    cone.direction << 1.0, 0.0;
+    cone.cos_threshold = std::cos(M_PI / 3);
+    cone.radius = 10;
+
+    SECTION("Cone membership") {
+        CHECK(cone.contains(Eigen::Vector2d(0, 0)));
+        CHECK(cone.contains(Eigen::Vector2d(9, 4)));
+        CHECK(!cone.contains(Eigen::Vector2d(2, 4)));
+        CHECK(!cone.contains(Eigen::Vector2d(-3, 0)));
+        CHECK(!cone.contains(Eigen::Vector2d(10, 1)));
+    }
+
+    SECTION("Boxes out of the cone are pruned") {
+        double behind_min[2] = {-8, -3};
+        double behind_max[2] = {-2, 3};
+        double beside_min[2] = {0.5, 3};
+        double beside_max[2] = {1.5, 8};
+        double far_min[2] = {11, -1};
+        double far_max[2] = {15, 1};
+        double ahead_min[2] = {4, -1};
+        double ahead_max[2] = {6, 1};
+        double around_min[2] = {-1, -1};
+        double around_max[2] = {1, 1};
+        CHECK(!cone.may_intersect(behind_min, behind_max));
+        CHECK(!cone.may_intersect(beside_min, beside_max));
+        CHECK(!cone.may_intersect(far_min, far_max));
+        CHECK(cone.may_intersect(ahead_min, ahead_max));
+        CHECK(cone.may_intersect(around_min, around_max));
+        // A cone wider than a half-plane is only bounded by its disk
+        cone.cos_threshold = std::cos(2 * M_PI / 3);
+        CHECK(cone.may_intersect(behind_min, behind_max));
+        CHECK(!cone.may_intersect(far_min, far_max));
+    }
+
+    SECTION("Unbounded tree visits the entities in the cone") {
+        std::vector<std::shared_ptr<Entity>> entities;
+        for (int i = 0; i < 64; ++i) {
+            entities.emplace_back(Entity::makeEntity(
+                Entity::Type::ANT, 5.0 * (i % 8), 3.0 * (i / 8)));
+        }
+        KDTree<Entity> tree;
+        tree.build(entities);
+        std::vector<std::uint32_t> expected;
+        for (std::uint32_t i = 0; i < entities.size(); ++i) {
+            if (cone.contains(entities[i]->pos() - cone.apex)) {
+                expected.push_back(i);
+            }
+        }
+        std::vector<std::uint32_t> visited;
+        tree.periodic_cone_visit(
+            cone, [&](std::uint32_t index, const Eigen::Vector2d& offset) {
+                CHECK(offset == entities[index]->pos() - cone.apex);
+                visited.push_back(index);
+            });
+        std::sort(visited.begin(), visited.end());
+        REQUIRE(!expected.empty());
+        REQUIRE(visited == expected);
+    }
+}
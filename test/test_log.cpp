@@ -0,0 +1,131 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Debug messages are compiled out of this file
+#define FLOCKS_MIN_LOG_LEVEL LOG_LEVEL_INFO
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+#include "log/log.h"
+
+namespace {
+// Log everything of f and return what was written
+template <typename F>
+std::string capture(F &&f, LogLevel level = LogLevel::LEVEL_INFO) {
+    std::ostringstream sink;
+    Logger &logger = Logger::instance();
+    LogLevel previous = logger.level();
+    logger.set_sink(&sink);
+    logger.set_level(level);
+    f();
+    logger.flush();
+    logger.set_sink(nullptr);
+    logger.set_level(previous);
+    return sink.str();
+}
+}  // namespace
+
+TEST_CASE("Log ring keeps records in order until full", "[log]") {
+    LogRing ring;
+    LogRecord record;
+    for (int i = 0; i < LOG_RING_CAPACITY; ++i) {
+        record.time = i;
+        REQUIRE(ring.try_push(record));
+    }
+    CHECK_FALSE(ring.try_push(record));
+
+    std::int64_t expected = 0;
+    std::size_t count = ring.drain([&](const LogRecord &popped) {
+        CHECK(popped.time == expected);
+        ++expected;
+    });
+    CHECK(count == LOG_RING_CAPACITY);
+    CHECK(ring.try_push(record));
+}
+
+TEST_CASE("Log lines format their arguments", "[log]") {
+    std::string output = capture([] {
+        LOG_INFO("int " << -42 << " size " << std::size_t(7) << " float "
+                        << 0.5f << " string " << std::string("abc")
+                        << " char " << 'x' << " bool " << true << "\n");
+        LOG_WARNING("careful");
+        LOG_ERROR(std::string(2 * LOG_RECORD_SIZE, 'a'));
+    });
+    CHECK(output ==
+          "int -42 size 7 float 0.5 string abc char x bool true\n"
+          "[warning] careful\n"
+          "[error] " + std::string(LOG_RECORD_SIZE, 'a') + "\n");
+}
+
+TEST_CASE("Log levels filter the messages", "[log]") {
+    int evaluations = 0;
+    auto count = [&] { return ++evaluations; };
+    std::string output = capture(
+        [&] {
+            LOG_INFO("info " << count());
+            LOG_WARNING("warning " << count());
+        },
+        LogLevel::LEVEL_WARNING);
+    CHECK(output == "[warning] warning 1\n");
+    CHECK(evaluations == 1);
+
+    // Compiled out, whatever the level
+    output = capture([&] { LOG_DEBUG("debug " << count()); },
+                     LogLevel::LEVEL_DEBUG);
+    CHECK(output.empty());
+    CHECK(evaluations == 1);
+}
+
+TEST_CASE("Logger starts at the info level", "[log]") {
+    // Debug messages, like the entity deletions, are only shown on demand
+    CHECK(Logger::instance().level() == LogLevel::LEVEL_INFO);
+    CHECK_FALSE(Logger::instance().enabled(LogLevel::LEVEL_DEBUG));
+}
+
+TEST_CASE("Logger keeps the order of each thread", "[log]") {
+    const int thread_count = 4;
+    const int message_count = 200;
+    // Other tests may have flooded their rings before
+    std::uint64_t dropped = Logger::instance().dropped();
+    std::string output = capture([&] {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([t, message_count] {
+                for (int i = 0; i < message_count; ++i) {
+                    LOG_INFO(t << " " << i);
+                }
+            });
+        }
+        for (auto &&thread : threads) {
+            thread.join();
+        }
+    });
+
+    std::istringstream lines(output);
+    std::vector<int> next(thread_count, 0);
+    int t, i;
+    while (lines >> t >> i) {
+        REQUIRE(t >= 0);
+        REQUIRE(t < thread_count);
+        CHECK(i == next[t]);
+        next[t] = i + 1;
+    }
+    for (int t = 0; t < thread_count; ++t) {
+        CHECK(next[t] == message_count);
+    }
+    CHECK(Logger::instance().dropped() == dropped);
+}
@@ -0,0 +1,120 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <set>
+#include <vector>
+#include "catch.hpp"
+#include "entity/ant/ant.h"
+#include "entity/object_pool.h"
+#include "world/world.h"
+
+TEST_CASE("Slab pool reuses blocks and invalidates handles",
+          "[object_pool]") {
+    SlabPool pool(24, 4);
+    REQUIRE(pool.block_size() == 24);
+    std::vector<void *> blocks;
+    for (int i = 0; i < 6; ++i) {
+        blocks.push_back(pool.allocate());
+    }
+    CHECK(pool.live() == 6);
+    CHECK(pool.capacity() == 6);
+    CHECK(pool.slab_count() == 2);
+    CHECK(std::set<void *>(blocks.begin(), blocks.end()).size() == 6);
+    for (void *block : blocks) {
+        CHECK(reinterpret_cast<std::uintptr_t>(block) % POOL_ALIGNMENT == 0);
+    }
+
+    PoolHandle handle = pool.handle(blocks[2]);
+    CHECK(pool.get(handle) == blocks[2]);
+    pool.deallocate(blocks[2]);
+    CHECK(pool.live() == 5);
+    CHECK(pool.get(handle) == nullptr);
+
+    // The block comes back with a new generation
+    void *reused = pool.allocate();
+    CHECK(reused == blocks[2]);
+    CHECK(pool.capacity() == 6);
+    CHECK(pool.get(handle) == nullptr);
+    PoolHandle new_handle = pool.handle(reused);
+    CHECK(new_handle.index == handle.index);
+    CHECK(new_handle != handle);
+    CHECK(pool.get(new_handle) == reused);
+    CHECK(pool.get(PoolHandle()) == nullptr);
+}
+
+TEST_CASE("Slab pool sized by its first request", "[object_pool]") {
+    SlabPool pool;
+    CHECK(pool.serves(40, 8));
+    CHECK(pool.block_size() == 40);
+    CHECK(pool.serves(40, 8));
+    CHECK_FALSE(pool.serves(48, 8));
+    CHECK_FALSE(pool.serves(40, 2 * POOL_ALIGNMENT));
+}
+
+TEST_CASE("World draws its entities from pools", "[object_pool][world]") {
+    World world(640, 480, 1e-2);
+    const SlabPool &ants = world.pools().objects(Entity::Type::ANT);
+    const SlabPool &controls = world.pools().control_blocks(Entity::Type::ANT);
+    for (int i = 0; i < 20; ++i) {
+        world.add_entity(Entity::Type::ANT, 10.0 + i, 20.0);
+    }
+    world.add_entity(Entity::Type::FOOD, 30.0, 30.0);
+    CHECK(ants.live() == 20);
+    CHECK(controls.live() == 20);
+    CHECK(world.pools().objects(Entity::Type::FOOD).live() == 1);
+
+    SECTION("Handles go stale when the entity is destroyed") {
+        Entity *ant = world.find_entity(Entity::Type::ANT, 7).lock().get();
+        EntityHandle handle = world.handle(*ant);
+        CHECK(world.resolve(handle) == ant);
+        world.remove_entity(Entity::Type::ANT, 7);
+        world.apply_removals();
+        CHECK(ants.live() == 19);
+        CHECK(world.resolve(handle) == nullptr);
+
+        // The memory of the destroyed ant is reused by the next one
+        auto newcomer = world.add_entity(Entity::Type::ANT, 1.0, 1.0).lock();
+        CHECK(newcomer.get() == ant);
+        CHECK(world.resolve(handle) == nullptr);
+        CHECK(world.resolve(world.handle(*newcomer)) == newcomer.get());
+    }
+
+    SECTION("Spawn and despawn waves do not grow the pools") {
+        for (int wave = 0; wave < 5; ++wave) {
+            for (int i = 0; i < 20; ++i) {
+                world.remove_entity(Entity::Type::ANT, 20 * wave + i);
+            }
+            world.apply_removals();
+            for (int i = 0; i < 20; ++i) {
+                world.add_entity(Entity::Type::ANT, 10.0 + i, 20.0);
+            }
+        }
+        CHECK(ants.live() == 20);
+        CHECK(ants.capacity() == 20);
+        CHECK(controls.capacity() == 20);
+    }
+
+    SECTION("Entities outliving the world keep their pool") {
+        std::shared_ptr<Entity> survivor;
+        {
+            World short_lived(640, 480, 1e-2);
+            survivor =
+                short_lived.add_entity(Entity::Type::ANT, 1.0, 2.0).lock();
+        }
+        CHECK(survivor->type() == Entity::Type::ANT);
+        CHECK(survivor->pos()(0) == Approx(1.0));
+        survivor.reset();
+    }
+}
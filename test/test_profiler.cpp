@@ -0,0 +1,86 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sstream>
+#include <string>
+#include "catch.hpp"
+#include "world/profiler.h"
+#include "world/world.h"
+
+TEST_CASE("Profiler rolling statistics", "[profiler]") {
+    Profiler profiler({"first", "second"}, 100);
+    REQUIRE(profiler.phase_count() == 2);
+    REQUIRE(profiler.window() == 100);
+
+    SECTION("Empty phases") {
+        Profiler::Stats stats = profiler.stats(0);
+        CHECK(stats.count == 0);
+        CHECK(stats.p50 == 0);
+        CHECK(stats.max == 0);
+    }
+
+    SECTION("Percentiles over a full window") {
+        for (int i = 1; i <= 100; ++i) {
+            profiler.record(0, i);
+        }
+        Profiler::Stats stats = profiler.stats(0);
+        CHECK(stats.count == 100);
+        CHECK(stats.last == 100);
+        CHECK(stats.mean == Approx(50.5));
+        CHECK(stats.p50 == 50);
+        CHECK(stats.p99 == 99);
+        CHECK(stats.max == 100);
+        CHECK(profiler.stats(1).count == 0);
+    }
+
+    SECTION("Old samples leave the window") {
+        for (int i = 0; i < 100; ++i) {
+            profiler.record(1, 1000);
+        }
+        for (int i = 0; i < 100; ++i) {
+            profiler.record(1, 1);
+        }
+        Profiler::Stats stats = profiler.stats(1);
+        CHECK(stats.count == 200);
+        CHECK(stats.max == 1);
+        CHECK(profiler.total(1) == Approx(100100));
+    }
+
+    SECTION("CSV and JSON dumps list every phase") {
+        profiler.record(0, 0.5);
+        std::ostringstream csv;
+        profiler.write_csv(csv);
+        CHECK(csv.str().find("first,1,0.5") != std::string::npos);
+        CHECK(csv.str().find("second,0") != std::string::npos);
+        std::ostringstream json;
+        profiler.write_json(json);
+        CHECK(json.str().find("\"first\"") != std::string::npos);
+        CHECK(json.str().find("\"second\"") != std::string::npos);
+    }
+}
+
+TEST_CASE("World profiles the phases of its updates", "[profiler][world]") {
+    World world(640, 480, 1e-2);
+    world.add_entity(Entity::Type::ANT, 10, 10);
+    world.update();
+    world.update();
+    const Profiler &profiler = world.profiler();
+    REQUIRE(profiler.phase_count() == WORLD_PHASE_COUNT);
+    for (int phase = 0; phase < WORLD_PHASE_COUNT; ++phase) {
+        CHECK(profiler.count(phase) == 2);
+        CHECK(profiler.phase_name(phase) ==
+              World::phase_name(static_cast<World::Phase>(phase)));
+        CHECK(profiler.last(phase) >= 0);
+    }
+}
@@ -0,0 +1,143 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "catch.hpp"
+#include "entity/ant/ant.h"
+#include "entity/food/food.h"
+#include "world/snapshot.h"
+#include "world/world.h"
+
+static const char *snapshot_events = R"({
+    "events": [
+        {
+            "time_stamp": 1.5,
+            "creation": {
+                "type": "ant_default.json",
+                "world_situation": {"position": [25, 43.9]}
+            }
+        },
+        {
+            "time_stamp": 40,
+            "creation": {
+                "type": "ant_worker.json",
+                "world_situation": {
+                    "position": [30.8, 40],
+                    "velocity": [1, -2]
+                }
+            }
+        },
+        {"time_stamp": 50, "destruction": {"type": "Ant", "id": 1}}
+    ]
+})";
+
+TEST_CASE("World snapshot round trip", "[world][snapshot]") {
+    std::string path = "test_world_snapshot.bin";
+    World world(640, 480, 1);
+    world.set_seed(12);
+    std::istringstream events(snapshot_events);
+    world.add_events(events);
+    for (int i = 0; i < 8; ++i) {
+        world.add_entity(Entity::Type::ANT);
+    }
+    world.add_entity(Entity::Type::FOOD, 30, 30);
+    auto special = std::static_pointer_cast<Ant>(
+        world.add_entity(Entity::Type::ANT, 100, 100, 2, 1).lock());
+    special->set_mass(3.5);
+    special->set_friction_factor(0.2);
+    special->set_cohesion_weight(0.25);
+    special->blind_color[2] = 0x33;
+    for (int i = 0; i < 5; ++i) {
+        world.update();
+    }
+    REQUIRE(world.save_snapshot(path));
+
+    World restored(10, 10, 0.5);
+    REQUIRE(restored.load_snapshot(path));
+
+    CHECK(restored.time() == world.time());
+    CHECK(restored.time_step() == world.time_step());
+    CHECK(restored._width == 640);
+    CHECK(restored._height == 480);
+    CHECK(restored.seed() == 12);
+    REQUIRE(restored.entity_list().size() == world.entity_list().size());
+    for (std::size_t i = 0; i < world.entity_list().size(); ++i) {
+        const Entity &before = *world.entity_list()[i];
+        const Entity &after = *restored.entity_list()[i];
+        CHECK(before.type_string() == after.type_string());
+        CHECK(before.id() == after.id());
+        CHECK(before.pos() == after.pos());
+        CHECK(before.vel() == after.vel());
+        CHECK(before.acc() == after.acc());
+        CHECK(before.mass() == after.mass());
+        CHECK(before.friction_factor() == after.friction_factor());
+        CHECK(before.vision_distance() == after.vision_distance());
+        CHECK(after.slot() == i);
+    }
+    const Ant &special_after = static_cast<const Ant &>(
+        *restored.entity_list()[special->slot()]);
+    CHECK(special_after.ant_params().cohesion_weight == Approx(0.25));
+    CHECK(special_after.blind_color[2] == 0x33);
+    // Only the events after the snapshot time are kept
+    CHECK(restored.events().list().size() == 2);
+
+    SECTION("Restored world evolves like the original") {
+        for (int i = 0; i < 45; ++i) {
+            world.update();
+            restored.update();
+        }
+        REQUIRE(restored.entity_list().size() == world.entity_list().size());
+        for (std::size_t i = 0; i < world.entity_list().size(); ++i) {
+            CHECK(world.entity_list()[i]->pos() ==
+                  restored.entity_list()[i]->pos());
+        }
+    }
+
+    SECTION("Streamed events are saved without being pulled") {
+        std::string events_path = "test_world_snapshot_events.json";
+        std::ofstream events_file(events_path, std::ios::trunc);
+        events_file << snapshot_events;
+        events_file.close();
+        World streaming(640, 480, 1);
+        REQUIRE(streaming.stream_events(events_path));
+        streaming.update();
+        std::size_t held = streaming.events().list().size();
+        REQUIRE(streaming.save_snapshot(path));
+        CHECK(streaming.events().list().size() == held);
+        REQUIRE(restored.load_snapshot(path));
+        CHECK(restored.events().list().size() == 3);
+        std::remove(events_path.c_str());
+    }
+
+    SECTION("Corrupted snapshots are rejected") {
+        std::ifstream in(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)),
+                          std::istreambuf_iterator<char>());
+        in.close();
+        std::string bad_path = "test_world_snapshot_bad.bin";
+        std::ofstream out(bad_path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size() / 2);
+        out.close();
+
+        std::size_t count = restored.entity_list().size();
+        CHECK_FALSE(restored.load_snapshot(bad_path));
+        CHECK_FALSE(restored.load_snapshot("missing_snapshot.bin"));
+        CHECK(restored.entity_list().size() == count);
+        std::remove(bad_path.c_str());
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,98 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <string>
+#include "FlockingConfig.h"
+#include "catch.hpp"
+#include "entity/template_registry.h"
+#include "jsoncpp/json/json.h"
+#include "world/world.h"
+
+TEST_CASE("Template registry parses templates once",
+          "[templates][json_read]") {
+    TemplateRegistry registry(std::string(DATA_DIR) + "entity/");
+
+    Json::Value worker_root;
+    std::fstream worker_file;
+    worker_file.open(std::string(DATA_DIR) + "entity/ant_worker.json",
+                     std::ios::in);
+    REQUIRE(worker_file.is_open());
+    worker_file >> worker_root;
+
+    SECTION("Parsed parameters match the file") {
+        const EntityTemplate *worker = registry.get("ant_worker.json");
+        REQUIRE(worker != nullptr);
+        CHECK(worker->type == Entity::Type::ANT);
+        CHECK(worker->params.mass == Approx(worker_root["mass"].asFloat()));
+        CHECK(worker->params.vision_distance ==
+              Approx(worker_root["vision"]["distance"].asFloat()));
+        CHECK(worker->ant.cruise_speed ==
+              Approx(worker_root["cruise_speed"].asFloat()));
+        CHECK(worker->ant.alignment_weight ==
+              Approx(worker_root["decision_weights"]["alignment"].asFloat()));
+        CHECK(worker->capped_force_color[2] ==
+              worker_root["colors"]["capped_force"][2].asInt());
+    }
+
+    SECTION("A template is only loaded once") {
+        const EntityTemplate *first = registry.get("ant_worker.json");
+        const EntityTemplate *second = registry.get("ant_worker.json");
+        CHECK(first == second);
+        CHECK(registry.size() == 1);
+    }
+
+    SECTION("Missing templates are reported") {
+        CHECK(registry.get("no_such_template.json") == nullptr);
+        CHECK(registry.size() == 0);
+    }
+
+    SECTION("Preloading reads every template but the schemas") {
+        CHECK(registry.preload() == 4);
+        CHECK(registry.size() == 4);
+        CHECK(registry.get("schema_ant.json") == nullptr);
+    }
+
+    SECTION("Ant templates are checked against the schema") {
+        Json::Value broken = worker_root;
+        broken["mass"] = 0;
+        CHECK_FALSE(registry.add("broken.json", broken));
+        broken = worker_root;
+        broken.removeMember("cruise_speed");
+        CHECK_FALSE(registry.add("broken.json", broken));
+        broken = worker_root;
+        broken["decision_weights"]["cohesion"] = 1.5;
+        CHECK_FALSE(registry.add("broken.json", broken));
+        CHECK(registry.get("broken.json") == nullptr);
+        CHECK(registry.add("copy.json", worker_root));
+        CHECK(registry.get("copy.json") != nullptr);
+    }
+}
+
+TEST_CASE("World spawns entities from cached templates",
+          "[templates][world][add_entity]") {
+    World world(640, 480, 1e-2);
+    REQUIRE(world.preload_templates() == 4);
+    for (int i = 0; i < 10; ++i) {
+        world.add_entity("ant_soldier.json", 10.0 * i, 20.0);
+    }
+    REQUIRE(world.entity_list().size() == 10);
+    const EntityTemplate *soldier = world.templates().get("ant_soldier.json");
+    for (auto &&entity : world.entity_list()) {
+        auto ant = std::dynamic_pointer_cast<Ant>(entity);
+        REQUIRE(ant);
+        CHECK(ant->mass() == Approx(soldier->params.mass));
+        CHECK(ant->cruise_speed() == Approx(soldier->ant.cruise_speed));
+    }
+}
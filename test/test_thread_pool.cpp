@@ -0,0 +1,52 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <vector>
+#include "catch.hpp"
+#include "world/thread_pool.h"
+
+TEST_CASE("Thread pool runs every task once", "[thread_pool]") {
+    SECTION("Inline pool") {
+        ThreadPool pool(1);
+        REQUIRE(pool.size() == 1);
+        std::vector<int> hits(10, 0);
+        pool.run(hits.size(), [&](std::size_t i) { ++hits[i]; });
+        for (auto &&hit : hits) {
+            CHECK(hit == 1);
+        }
+    }
+
+    SECTION("Pool with workers, over several batches") {
+        ThreadPool pool(4);
+        REQUIRE(pool.size() == 4);
+        std::vector<int> hits(1000, 0);
+        std::atomic<int> calls{0};
+        for (int batch = 0; batch < 20; ++batch) {
+            pool.run(hits.size(), [&](std::size_t i) {
+                ++hits[i];
+                ++calls;
+            });
+        }
+        CHECK(calls == 20000);
+        for (auto &&hit : hits) {
+            CHECK(hit == 20);
+        }
+    }
+
+    SECTION("Empty batch") {
+        ThreadPool pool(3);
+        pool.run(0, [](std::size_t) { FAIL("No task should run"); });
+    }
+}
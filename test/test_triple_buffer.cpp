@@ -0,0 +1,71 @@
+/* Copyright (c) 2018 Gerry Agbobada
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+#include "world/triple_buffer.h"
+
+TEST_CASE("Triple buffer hands over the latest value", "[triple_buffer]") {
+    TripleBuffer<int> buffer;
+    CHECK_FALSE(buffer.update());
+    CHECK(buffer.front() == 0);
+
+    buffer.back() = 1;
+    buffer.publish();
+    buffer.back() = 2;
+    buffer.publish();
+    // Only the latest value is seen, the first one was overwritten
+    CHECK(buffer.update());
+    CHECK(buffer.front() == 2);
+    CHECK_FALSE(buffer.update());
+    CHECK(buffer.front() == 2);
+
+    buffer.back() = 3;
+    buffer.publish();
+    CHECK(buffer.update());
+    CHECK(buffer.front() == 3);
+}
+
+TEST_CASE("Triple buffer values are consistent across threads",
+          "[triple_buffer]") {
+    // Each value is a vector filled with its own number : the reader must
+    // never see a partially written one, nor go back in time
+    TripleBuffer<std::vector<int>> buffer;
+    const int count = 20000;
+    std::thread writer([&]() {
+        for (int value = 1; value <= count; ++value) {
+            buffer.back().assign(64, value);
+            buffer.publish();
+        }
+    });
+
+    int last = 0;
+    bool consistent = true;
+    while (last < count) {
+        if (!buffer.update()) {
+            std::this_thread::yield();
+            continue;
+        }
+        const std::vector<int> &value = buffer.front();
+        for (int item : value) {
+            consistent = consistent && item == value.front();
+        }
+        consistent = consistent && value.front() > last;
+        last = value.front();
+    }
+    writer.join();
+    CHECK(consistent);
+    CHECK(last == count);
+}
@@ -13,11 +13,17 @@
  */
 
 #include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <future>
 #include <string>
 #include <memory>
+#include <set>
+#include <sstream>
 #include "catch.hpp"
 #include "entity/ant/ant.h"
+#include "entity/food/food.h"
 #include "jsoncpp/json/json.h"
 #include "world/world.h"
 #include "FlockingConfig.h"
@@ -297,4 +303,523 @@ TEST_CASE("World computes good neighbourhoods for entities",
         inside_neigh = inside_see_all->neighbours();
         CHECK(inside_neigh.size() == 5);
     }
+
+    SECTION("Neighbour lists are rows of the world neighbour table") {
+        const auto &table = world.neighbour_table();
+        REQUIRE(table.rows() == world.entity_list().size());
+        std::size_t total = 0;
+        for (auto &&entity : world.entity_list()) {
+            auto neighbours = entity->neighbours();
+            for (std::size_t i = 0; i < neighbours.size(); ++i) {
+                CHECK(world.entity_list()[neighbours.index(i)].get() ==
+                      &neighbours[i]);
+            }
+            total += neighbours.size();
+        }
+        CHECK(table.total() == total);
+    }
+
+    SECTION("Entities outside of the world have no neighbours") {
+        Ant lonely(1, world, 320.0, 240.0);
+        CHECK(lonely.neighbours().size() == 0);
+    }
+}
+
+TEST_CASE("Moving ants only get the neighbours in their vision cone",
+          "[world][neighbour_computation][cone]") {
+    World world(640, 480, 1e-2);
+    Ant* walker = dynamic_cast<Ant*>(
+        world.add_entity(Entity::Type::ANT, 320.0, 240.0, 10.0, 0.0)
+            .lock()
+            .get());
+    Ant* stander = dynamic_cast<Ant*>(
+        world.add_entity(Entity::Type::ANT, 320.0, 240.0).lock().get());
+    walker->set_vision_distance(100.0);
+    stander->set_vision_distance(100.0);
+    // A ring of ants around both, 60 units away
+    for (int i = 0; i < 36; ++i) {
+        double angle = (i + 0.5) * M_PI / 18;
+        world.add_entity(Entity::Type::ANT, 320.0 + 60 * std::cos(angle),
+                         240.0 + 60 * std::sin(angle));
+    }
+
+    world.update_tree();
+    world.update_entity_neighbourhoods();
+    // The default 60 degrees on each side see a third of the ring, and the
+    // ants on the apex
+    CHECK(walker->neighbours().size() == 12 + 2);
+    CHECK(stander->neighbours().size() == 36 + 2);
+    VisionCone cone;
+    REQUIRE(walker->vision_cone(cone));
+    REQUIRE(!stander->vision_cone(cone));
+    auto neighbours = walker->neighbours();
+    for (std::size_t i = 0; i < neighbours.size(); ++i) {
+        CHECK(walker->is_in_vision_triangle(
+            world.point_to(walker->pos(), neighbours[i].pos())));
+    }
+}
+
+TEST_CASE("Ants keep the neighbours seen across the world edges",
+          "[world][neighbour_computation][vision]") {
+    for (World::SpatialIndex index :
+         {World::SpatialIndex::KDTREE, World::SpatialIndex::CELL_GRID}) {
+        World world(640, 480, 1e-2, index);
+        // In the corner, heading across both seams
+        Ant* walker = dynamic_cast<Ant*>(
+            world.add_entity(Entity::Type::ANT, 2.0, 2.0, -10.0, -10.0)
+                .lock()
+                .get());
+        walker->set_vision_distance(100.0);
+        // Across x = 0, across y = 0, across both, and behind
+        world.add_entity(Entity::Type::ANT, 630.0, 2.0);
+        world.add_entity(Entity::Type::ANT, 2.0, 470.0);
+        world.add_entity(Entity::Type::ANT, 630.0, 470.0);
+        world.add_entity(Entity::Type::ANT, 20.0, 20.0);
+
+        world.update_tree();
+        world.update_entity_neighbourhoods();
+        REQUIRE(walker->neighbours().size() == 3 + 1);
+        walker->decision();
+        CHECK(walker->neighbours().size() == 3 + 1);
+        CHECK(!std::equal(walker->color(), walker->color() + 4,
+                          walker->blind_color));
+        // Drawn back towards the flock across the seams
+        CHECK(walker->acc()(0) < 0);
+        CHECK(walker->acc()(1) < 0);
+    }
+}
+
+TEST_CASE("World neighbourhoods do not depend on the spatial index",
+          "[world][neighbour_computation][cellgrid]") {
+    World tree_world(640, 480, 1e-2, World::SpatialIndex::KDTREE);
+    World grid_world(640, 480, 1e-2, World::SpatialIndex::CELL_GRID);
+    REQUIRE(grid_world.spatial_index() == World::SpatialIndex::CELL_GRID);
+    for (int i = 0; i < 50; ++i) {
+        float x = (83 * i) % 640;
+        float y = (59 * i) % 480;
+        tree_world.add_entity(Entity::Type::ANT, x, y);
+        grid_world.add_entity(Entity::Type::ANT, x, y);
+    }
+    tree_world.update_tree();
+    tree_world.update_entity_neighbourhoods();
+    grid_world.update_tree();
+    grid_world.update_entity_neighbourhoods();
+
+    for (std::size_t i = 0; i < tree_world.entity_list().size(); ++i) {
+        CHECK(tree_world.entity_list()[i]->neighbours().size() ==
+              grid_world.entity_list()[i]->neighbours().size());
+    }
+}
+
+TEST_CASE("World keeps the kinematic state in its store", "[world][store]") {
+    World world(640, 480, 1e-2);
+    world.add_entity(Entity::Type::FOOD, 10.0, 20.0);
+    world.add_entity(Entity::Type::ANT, 30.0, 40.0, 5.0, -5.0);
+    world.add_entity(Entity::Type::ANT, 635.0, 2.0, 300.0, -300.0);
+
+    SECTION("Store slots follow the entity list") {
+        const auto &store = world.store();
+        REQUIRE(store.size() == world.entity_list().size());
+        for (std::size_t i = 0; i < store.size(); ++i) {
+            const auto &entity = world.entity_list()[i];
+            CHECK(store.owner(i) == entity.get());
+            CHECK(&store.position(i) == &entity->pos());
+            CHECK(&store.velocity(i) == &entity->vel());
+        }
+    }
+
+    SECTION("Spawned entities never go through the detached store") {
+        std::size_t detached = EntityStore::detached().size();
+        world.add_entity(Entity::Type::ANT, 1.0, 1.0);
+        CHECK(EntityStore::detached().size() == detached);
+        // Worlds on other threads spawn without sharing a store
+        auto spawn = [] {
+            World other(640, 480, 1e-2);
+            for (int i = 0; i < 200; ++i) {
+                other.add_entity(Entity::Type::ANT, 1.0 * i, 2.0);
+            }
+            return other.store().size() == 200 &&
+                   EntityStore::detached().size() == 0;
+        };
+        auto first = std::async(std::launch::async, spawn);
+        auto second = std::async(std::launch::async, spawn);
+        CHECK(first.get());
+        CHECK(second.get());
+    }
+
+    SECTION("Integrating the store matches Entity::update") {
+        World reference(640, 480, 1e-2);
+        for (auto &&entity : world.entity_list()) {
+            reference.add_entity(entity->type(), entity->pos()(0),
+                                 entity->pos()(1), entity->vel()(0),
+                                 entity->vel()(1));
+        }
+        world.integrate_store();
+        for (auto &&entity : reference.entity_list()) {
+            entity->update();
+        }
+        for (std::size_t i = 0; i < world.entity_list().size(); ++i) {
+            const auto &lhs = world.entity_list()[i];
+            const auto &rhs = reference.entity_list()[i];
+            CHECK(lhs->pos() == rhs->pos());
+            CHECK(lhs->vel() == rhs->vel());
+        }
+    }
+
+    SECTION("Entities outliving the world keep their state") {
+        std::shared_ptr<Entity> survivor;
+        {
+            World short_lived(640, 480, 1e-2);
+            survivor =
+                short_lived.add_entity(Entity::Type::ANT, 1.0, 2.0).lock();
+        }
+        CHECK(survivor->pos()(0) == Approx(1.0));
+        CHECK(survivor->pos()(1) == Approx(2.0));
+    }
+}
+
+TEST_CASE("World removes entities at the end of a tick", "[world][remove]") {
+    World world(640, 480, 1e-2);
+    for (int i = 0; i < 10; ++i) {
+        world.add_entity(Entity::Type::ANT, 10.0 + 20 * i, 20.0, 1.0, 0.0);
+    }
+    world.add_entity(Entity::Type::FOOD, 300.0, 300.0);
+
+    SECTION("Removed entities are swapped with the last ones") {
+        auto ant_9 = world.find_entity(Entity::Type::ANT, 9).lock();
+        auto ant_8 = world.find_entity(Entity::Type::ANT, 8).lock();
+        auto food = world.find_entity(Entity::Type::FOOD, 0).lock();
+        REQUIRE(ant_9->slot() == 9);
+        REQUIRE(world.remove_entity(Entity::Type::ANT, 2));
+        REQUIRE(world.remove_entity(Entity::Type::ANT, 5));
+        REQUIRE(world.remove_entity(Entity::Type::ANT, 2));
+        REQUIRE_FALSE(world.remove_entity(Entity::Type::ANT, 42));
+        REQUIRE_FALSE(world.remove_entity(Entity::Type::FOOD, 1));
+        // Nothing changes before the end of the tick
+        REQUIRE(world.entity_list().size() == 11);
+        std::size_t detached = EntityStore::detached().size();
+        world.update();
+        REQUIRE(world.pending_removals() == 0);
+        REQUIRE(world.entity_list().size() == 9);
+        CHECK(world.find_entity(Entity::Type::ANT, 2).expired());
+        CHECK(world.find_entity(Entity::Type::ANT, 5).expired());
+        // Slot 5 went first and got the food, then slot 2 got ant 9
+        CHECK(food->slot() == 5);
+        CHECK(ant_9->slot() == 2);
+        CHECK(ant_8->slot() == 8);
+
+        // Nothing else held the removed ants, they were not detached
+        CHECK(EntityStore::detached().size() == detached);
+        const auto &store = world.store();
+        REQUIRE(store.size() == world.entity_list().size());
+        for (std::size_t i = 0; i < store.size(); ++i) {
+            const auto &entity = world.entity_list()[i];
+            CHECK(entity->slot() == i);
+            CHECK(store.owner(i) == entity.get());
+            CHECK(&store.position(i) == &entity->pos());
+            CHECK(world.find_entity(entity->type(), entity->id()).lock() ==
+                  entity);
+        }
+        // The previous state moved with the entities
+        CHECK(store.previous_positions()[2](0) == Approx(190.0));
+        CHECK(store.previous_positions()[5](0) == Approx(300.0));
+    }
+
+    SECTION("Removed entities still shared keep their state") {
+        auto ant_3 = world.find_entity(Entity::Type::ANT, 3).lock();
+        world.remove_entity(Entity::Type::ANT, 3);
+        world.update();
+        CHECK(ant_3->slot() == ENTITY_NO_SLOT);
+        Eigen::Vector2d last_position = ant_3->pos();
+        CHECK(last_position(0) == Approx(70.0).margin(1));
+        // It is not integrated anymore
+        world.update();
+        CHECK(ant_3->pos() == last_position);
+    }
+
+    SECTION("Destruction events remove entities") {
+        std::istringstream events(R"({"events": [
+            {"time_stamp": 0.015, "destruction": {"type": "Ant", "id": 4}},
+            {"time_stamp": 0.015, "destruction": {"type": "Food", "id": 0}},
+            {"time_stamp": 0.015, "destruction": {"type": "Ant", "id": 99}}
+        ]})");
+        world.add_events(events);
+        world.update();
+        CHECK(world.entity_list().size() == 11);
+        world.update();
+        CHECK(world.entity_list().size() == 9);
+        CHECK(world.find_entity(Entity::Type::ANT, 4).expired());
+        CHECK(world.find_entity(Entity::Type::FOOD, 0).expired());
+    }
+
+    SECTION("Removing every entity at once") {
+        for (int i = 0; i < 10; ++i) {
+            world.remove_entity(Entity::Type::ANT, i);
+        }
+        world.remove_entity(Entity::Type::FOOD, 0);
+        world.update();
+        CHECK(world.entity_list().empty());
+        CHECK(world.store().size() == 0);
+        world.add_entity(Entity::Type::ANT, 1.0, 1.0);
+        CHECK(world.find_entity(Entity::Type::ANT, 10).lock()->slot() == 0);
+    }
+}
+
+TEST_CASE("World neighbourhoods do not depend on the thread count",
+          "[world][neighbour_computation][threads]") {
+    World serial_world(640, 480, 1e-2);
+    World parallel_world(640, 480, 1e-2);
+    parallel_world.set_thread_count(4);
+    REQUIRE(parallel_world.thread_count() == 4);
+    for (int i = 0; i < 203; ++i) {
+        float x = (83 * i) % 640;
+        float y = (59 * i) % 480;
+        serial_world.add_entity(Entity::Type::ANT, x, y);
+        parallel_world.add_entity(Entity::Type::ANT, x, y);
+    }
+
+    for (int tick = 0; tick < 2; ++tick) {
+        serial_world.update_tree();
+        serial_world.update_entity_neighbourhoods();
+        parallel_world.update_tree();
+        parallel_world.update_entity_neighbourhoods();
+
+        REQUIRE(parallel_world.neighbour_table().rows() ==
+                serial_world.neighbour_table().rows());
+        REQUIRE(parallel_world.neighbour_table().total() ==
+                serial_world.neighbour_table().total());
+        for (std::size_t i = 0; i < serial_world.entity_list().size(); ++i) {
+            auto serial = serial_world.entity_list()[i]->neighbours();
+            auto parallel = parallel_world.entity_list()[i]->neighbours();
+            REQUIRE(serial.size() == parallel.size());
+            for (std::size_t j = 0; j < serial.size(); ++j) {
+                CHECK(serial.index(j) == parallel.index(j));
+            }
+        }
+    }
+}
+
+TEST_CASE("World updates do not depend on the thread count",
+          "[world][update][threads]") {
+    World serial_world(640, 480, 1e-2);
+    World parallel_world(640, 480, 1e-2);
+    parallel_world.set_thread_count(3);
+    for (int i = 0; i < 157; ++i) {
+        float x = (83 * i) % 640;
+        float y = (59 * i) % 480;
+        float vx = (i % 7) - 3;
+        float vy = (i % 5) - 2;
+        serial_world.add_entity(Entity::Type::ANT, x, y, vx, vy);
+        parallel_world.add_entity(Entity::Type::ANT, x, y, vx, vy);
+    }
+
+    for (int tick = 0; tick < 20; ++tick) {
+        serial_world.update();
+        parallel_world.update();
+    }
+    for (std::size_t i = 0; i < serial_world.entity_list().size(); ++i) {
+        const auto &lhs = serial_world.entity_list()[i];
+        const auto &rhs = parallel_world.entity_list()[i];
+        // Bit for bit, not approximately
+        CHECK(lhs->pos()(0) == rhs->pos()(0));
+        CHECK(lhs->pos()(1) == rhs->pos()(1));
+        CHECK(lhs->vel()(0) == rhs->vel()(0));
+        CHECK(lhs->vel()(1) == rhs->vel()(1));
+    }
+}
+
+TEST_CASE("Verlet lists give the same neighbourhoods",
+          "[world][neighbour_computation][verlet]") {
+    World plain_world(640, 480, 1e-1);
+    World verlet_world(640, 480, 1e-1);
+    verlet_world.set_verlet_skin(30);
+    REQUIRE(verlet_world.verlet_skin() == Approx(30));
+    for (int i = 0; i < 120; ++i) {
+        float x = (83 * i) % 640;
+        float y = (59 * i) % 480;
+        float vx = 10 * ((i % 7) - 3);
+        float vy = 10 * ((i % 5) - 2);
+        plain_world.add_entity(Entity::Type::ANT, x, y, vx, vy);
+        verlet_world.add_entity(Entity::Type::ANT, x, y, vx, vy);
+        // Food sees nothing, even sitting on an ant
+        if (i % 20 == 0) {
+            plain_world.add_entity(Entity::Type::FOOD, x, y);
+            verlet_world.add_entity(Entity::Type::FOOD, x, y);
+        }
+    }
+
+    const int ticks = 40;
+    for (int tick = 0; tick < ticks; ++tick) {
+        // No decision, so both worlds follow the same straight lines
+        for (World *world : {&plain_world, &verlet_world}) {
+            world->update_tree();
+            world->update_entity_neighbourhoods();
+        }
+        for (std::size_t i = 0; i < plain_world.entity_list().size(); ++i) {
+            auto plain = plain_world.entity_list()[i]->neighbours();
+            auto verlet = verlet_world.entity_list()[i]->neighbours();
+            std::vector<std::uint32_t> lhs, rhs;
+            for (std::size_t j = 0; j < plain.size(); ++j) {
+                lhs.push_back(plain.index(j));
+            }
+            for (std::size_t j = 0; j < verlet.size(); ++j) {
+                rhs.push_back(verlet.index(j));
+            }
+            std::sort(lhs.begin(), lhs.end());
+            std::sort(rhs.begin(), rhs.end());
+            REQUIRE(lhs == rhs);
+        }
+        plain_world.integrate_store();
+        verlet_world.integrate_store();
+    }
+    // Entities move 1 to 3.6 units per tick, a skin of 30 lasts several ticks
+    CHECK(verlet_world.verlet_rebuilds() > 1);
+    CHECK(verlet_world.verlet_rebuilds() < ticks / 2);
+}
+
+TEST_CASE("Random placement only depends on seed, type and id",
+          "[world][random]") {
+    World world_1(640, 480, 1);
+    World world_2(640, 480, 1);
+    World world_3(640, 480, 1);
+    world_1.set_seed(7);
+    world_2.set_seed(7);
+    world_3.set_seed(8);
+
+    // Same ids created in a different order, with other entities in between
+    Ant ant_1a(1, world_1);
+    Ant ant_2a(2, world_1);
+    Food food_2(2, world_2);
+    Ant ant_2b(2, world_2);
+    Ant ant_1b(1, world_2);
+    Ant ant_1c(1, world_3);
+
+    CHECK(ant_1a.pos() == ant_1b.pos());
+    CHECK(ant_2a.pos() == ant_2b.pos());
+    CHECK(ant_1a.pos() != ant_2a.pos());
+    CHECK(food_2.pos() != ant_2b.pos());
+    CHECK(ant_1a.pos() != ant_1c.pos());
+    for (const Entity *entity : {&ant_1a, &ant_2a, &ant_1c}) {
+        CHECK(entity->pos()(0) >= 0);
+        CHECK(entity->pos()(0) < 640);
+        CHECK(entity->pos()(1) >= 0);
+        CHECK(entity->pos()(1) < 480);
+    }
+
+    RandomStream stream(7, 3);
+    std::uint64_t third = stream.at(2);
+    stream.next();
+    stream.next();
+    CHECK(stream.next() == third);
+    CHECK(stream.counter() == 3);
+}
+
+// Render target recording the batches it receives
+class RecordingTarget : public RenderTarget {
+ public:
+    void add_FillRect_to_renderer(int, int, int, int, int[4]) override {
+        ++immediate_rects;
+    }
+    void begin_batch() override { ++batches; }
+    void add_FillRect_to_batch(int, int, int, int, int color[4]) override {
+        ++batched_rects;
+        colors.insert(color[0] << 24 | color[1] << 16 | color[2] << 8 |
+                      color[3]);
+    }
+    void end_batch() override { ++flushes; }
+
+    int immediate_rects{0};
+    int batched_rects{0};
+    int batches{0};
+    int flushes{0};
+    std::set<int> colors{};
+};
+
+TEST_CASE("World renders its entities in one batch", "[world][render]") {
+    World world(640, 480, 1);
+    RecordingTarget target;
+    world.set_render_window(target);
+    for (int i = 0; i < 50; ++i) {
+        world.add_entity(Entity::Type::ANT);
+    }
+    world.update();
+    CHECK(target.batches == 1);
+    CHECK(target.flushes == 1);
+    CHECK(target.batched_rects == 50);
+    CHECK(target.immediate_rects == 0);
+    // Ants only use their three colors
+    CHECK(target.colors.size() <= 3);
+}
+
+TEST_CASE("World publishes frames with the last two states",
+          "[world][render]") {
+    World world(640, 480, 1);
+    TripleBuffer<RenderFrame> frames;
+    world.set_frame_buffer(&frames);
+    for (int i = 0; i < 20; ++i) {
+        world.add_entity(Entity::Type::ANT);
+    }
+    world.update();
+    // Updates alone do not publish
+    CHECK_FALSE(frames.update());
+
+    std::vector<Eigen::Vector2d> before;
+    for (auto &&entity : world.entity_list()) {
+        before.push_back(entity->pos());
+    }
+    world.update();
+    world.publish_frame(12.5);
+    REQUIRE(frames.update());
+    const RenderFrame &frame = frames.front();
+    CHECK(frame.tick == 2);
+    CHECK(frame.time == world.time());
+    CHECK(frame.time_step == 1);
+    CHECK(frame.due == 12.5);
+    CHECK(frame.world_width == 640);
+    CHECK(frame.world_height == 480);
+    REQUIRE(frame.items.size() == 20);
+    for (std::size_t i = 0; i < frame.items.size(); ++i) {
+        const Entity &entity = *world.entity_list()[i];
+        CHECK(frame.items[i].x == static_cast<float>(entity.pos()(0)));
+        CHECK(frame.items[i].y == static_cast<float>(entity.pos()(1)));
+        CHECK(frame.items[i].previous_x == static_cast<float>(before[i](0)));
+        CHECK(frame.items[i].previous_y == static_cast<float>(before[i](1)));
+    }
+    CHECK(frame.alpha(12) == 0);
+    CHECK(frame.alpha(13) == Approx(0.5));
+    CHECK(frame.alpha(20) == 1);
+
+    // A new entity has no previous state until the next update
+    world.add_entity(Entity::Type::ANT, 100, 200);
+    world.publish_frame();
+    REQUIRE(frames.update());
+    CHECK(frames.front().items.back().previous_x == 100);
+    CHECK(frames.front().items.back().previous_y == 200);
+}
+
+TEST_CASE("Frame interpolation takes the shortest way around",
+          "[world][render]") {
+    CHECK(RenderFrame::interpolate(10, 20, 0.5, 100) == Approx(15));
+    CHECK(RenderFrame::interpolate(10, 20, 0, 100) == Approx(10));
+    CHECK(RenderFrame::interpolate(10, 20, 1, 100) == Approx(20));
+    // Crossing the edge of the world
+    CHECK(RenderFrame::interpolate(98, 2, 0.25, 100) == Approx(99));
+    CHECK(RenderFrame::interpolate(98, 2, 0.75, 100) == Approx(1));
+    CHECK(RenderFrame::interpolate(2, 98, 0.75, 100) == Approx(99));
+}
+
+TEST_CASE("Window size is applied at the start of an update",
+          "[world][window]") {
+    World world(640, 480, 1e-2);
+    int width = world._width_in_px;
+    world.set_window_size(1024, 768);
+    CHECK(world._width_in_px == width);
+    world.update();
+    CHECK(world._width_in_px == 1024);
+    CHECK(world._height_in_px == 768);
+    world.set_window_size(800, 600);
+    world.set_window_size(320, 200);
+    world.update();
+    CHECK(world._width_in_px == 320);
+    CHECK(world._height_in_px == 200);
 }